@@ -31,22 +31,14 @@
 #include "inc/tar.h"
 
 size_t initrd_read(struct robject *self, rp_t source, uint8_t *buffer, size_t size, off_t offset) {
-	uint8_t *file_data;
-	off_t   *file_size;
+	uint8_t *file_data = (void*) BOOT_IMAGE;
 
-	file_data = robject_data(self, "data");
-	file_size = robject_data(self, "size");
-
-	if (!file_data || !file_size) {
-		return 0;
-	}
-
-	if (offset >= *file_size) {
+	if (offset >= self->size) {
 		return 0;
 	}
 
-	if (offset + size >= *file_size) {
-		size = *file_size - offset;
+	if (offset + size >= self->size) {
+		size = self->size - offset;
 	}
 
 	memcpy(buffer, &file_data[offset], size);
@@ -56,17 +48,12 @@ size_t initrd_read(struct robject *self, rp_t source, uint8_t *buffer, size_t si
 
 void initrd_init(void) {
 	struct robject *file;
-	off_t *size;
 
 	rdi_init();
 
+	// the boot image is the only file, so it needs no private data
 	file = rdi_file_cons(1, ACCS_READ);
-
-	robject_set_data(file, "data", (void*) BOOT_IMAGE);
-
-	size = malloc(sizeof(off_t));
-	*size = tar_size((void*) BOOT_IMAGE);
-	robject_set_data(file, "size", (void*) size);
+	file->size = tar_size((void*) BOOT_IMAGE);
 
 	rdi_global_read_hook = initrd_read;
 }
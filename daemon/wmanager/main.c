@@ -18,6 +18,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <errno.h>
 
 #include <rho/mutex.h>
 #include <rho/exec.h>
@@ -32,6 +33,7 @@
 struct robject *class_window;
 
 rp_t vgafd, mousefd, kbdfd;
+int vgafd_fd;
 bool winkey;
 
 char *wmanager_rcall_listmodes(struct robject *self, uint64_t source, int argc, char **argv) {
@@ -111,6 +113,23 @@ char *wmanager_rcall_syncrect(struct robject *self, uint64_t source, int argc, c
 	return strdup("T");
 }
 
+int wmanager_brcall_syncrect(struct robject *self, rp_t source, int argc, struct brcall_arg *argv) {
+	struct window_t *window;
+	int x, y, w, h;
+
+	window = find_window(self->index, RP_PID(source));
+	if (!window) return -ENOENT;
+
+	x = argv[0].i;
+	y = argv[1].i;
+	w = argv[2].i;
+	h = argv[3].i;
+
+	update_screen(window->x + x, window->y + y, window->x + x + w, window->y + y + h);
+
+	return 0;
+}
+
 char *wmanager_rcall_unshare(struct robject *self, uint64_t source, int argc, char **argv) {
 	struct window_t *window;
 
@@ -356,13 +375,13 @@ int main(int argc, char **argv) {
 	rdi_init();
 
 	root = rdi_dir_cons(1, ACCS_READ | ACCS_WRITE);
-	robject_set_data(root, "type", (void*) "wm");
+	robject_set_type(root, "wm");
 	robject_set_call(root, "createwindow", wmanager_rcall_createwindow, 0);
 
 	class_window = robject_cons(0, rdi_class_core);
 
 	robject_set_data(class_window, "name", (void*) "class-window");
-	robject_set_data(class_window, "type", (void*) "window canvas share event");
+	robject_set_type(class_window, "window canvas share event");
 
 	robject_set_call(class_window, "listmodes",      wmanager_rcall_listmodes, 0);
 	robject_set_call(class_window, "setmode",        wmanager_rcall_setmode,   0);
@@ -374,13 +393,15 @@ int main(int argc, char **argv) {
 	robject_set_call(class_window, "getmouse",       wmanager_rcall_getmouse,  STAT_READER);
 	robject_set_call(class_window, "setpanel",       wmanager_rcall_setpanel,  STAT_WRITER);
 	robject_set_call(class_window, "settags",        wmanager_rcall_settags,   STAT_WRITER);
+	robject_set_brcall(class_window, BRCALL_SYNCRECT, "iiii", wmanager_brcall_syncrect, STAT_WRITER);
 	
 	rdi_global_share_hook = wmanager_share;
 	rdi_global_cons_file_hook = wmanager_file_cons;
 
 	fs_plink("/sys/wmanager", RP_CONS(getpid(), root->index), NULL);
 
-	vgafd  = fd_rp(ropen(-1, fs_find("/dev/svga0"), STAT_READER | STAT_WRITER | STAT_EVENT));
+	vgafd_fd = ropen(-1, fs_find("/dev/svga0"), STAT_READER | STAT_WRITER | STAT_EVENT);
+	vgafd  = fd_rp(vgafd_fd);
 	sscanf(rcall(vgafd, "getmode"), "%i %i", &width, &height);
 	resize_screen(width, height);
 
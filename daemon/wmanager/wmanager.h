@@ -41,6 +41,7 @@ struct window_t {
 };
 
 extern rp_t vgafd;
+extern int vgafd_fd;
 extern uint32_t *screen;
 extern int screen_width, screen_height;
 extern struct window_t *windows;
@@ -228,6 +228,14 @@ void ata_init(void) {
 	}
 }
 
+/*
+ * Per-drive private data, kept in the robject's private area.
+ */
+
+struct ata_file {
+	uint32_t drive;
+};
+
 size_t ata_read(struct robject *self, rp_t source, uint8_t *buffer, size_t size, off_t offset) {
 	uint32_t drive;
 	uint8_t *buffer2;
@@ -236,18 +244,19 @@ size_t ata_read(struct robject *self, rp_t source, uint8_t *buffer, size_t size,
 	uint16_t count;
 	uint16_t i;
 
-	mutex_spin(&self->driver_mutex);
-
-	drive = (uint32_t) robject_data(self, "drive");
+	if (!self->priv) return 0;
+	drive = ((struct ata_file*) self->priv)->drive;
 
-	if (offset >= ata[drive].size << ata[drive].sectsize) {
+	if (offset >= self->size) {
 		return 0;
 	}
 
-	if (offset + size > ata[drive].size << ata[drive].sectsize) {
-		size = (ata[drive].size << ata[drive].sectsize) - offset;
+	if (offset + size > self->size) {
+		size = self->size - offset;
 	}
 
+	mutex_spin(&self->driver_mutex);
+
 	buf2off = offset & ((1 << ata[drive].sectsize) - 1);
 	count   = ((size + buf2off) >> ata[drive].sectsize);
 	buffer2 = malloc(count << ata[drive].sectsize);
@@ -273,7 +282,6 @@ size_t ata_read(struct robject *self, rp_t source, uint8_t *buffer, size_t size,
 
 int main(int argc, char **argv) {
 	struct robject *robject;
-	off_t *disksize;
 	uint32_t dr;
 	
 	rdi_init();
@@ -285,17 +293,18 @@ int main(int argc, char **argv) {
 			continue;
 		}
 		
-		robject = rdi_file_cons(robject_new_index(), ACCS_READ);
+		robject = rdi_file_cons_priv(robject_new_index(), ACCS_READ, sizeof(struct ata_file));
 
-		disksize = malloc(sizeof(off_t));
-		*disksize = ata[dr].size << ata[dr].sectsize;
-		robject_set_data(robject, "size", disksize);
-		robject_set_data(robject, "drive", (void*) dr);
+		((struct ata_file*) robject->priv)->drive = dr;
+		robject->size = ata[dr].size << ata[dr].sectsize;
 		robject_set_data(robject, "name", strdup(ata[dr].model));
 	}
 	
 	rdi_global_read_hook = ata_read;
 
+	// reads serialize on the drive anyway; queue bursts instead of spinning
+	rdi_set_concurrency(1);
+
 	msendb(RP_CONS(getppid(), 0), ACTION_CHILD);
 	_done();
 
@@ -97,6 +97,22 @@ char *fbterm_rcall_set_bgcolor(struct robject *self, rp_t source, int argc, char
 	return strdup("T");
 }
 
+int fbterm_brcall_set_fgcolor(struct robject *self, rp_t source, int argc, struct brcall_arg *argv) {
+
+	screen.fg = argv[0].i;
+	screen_sync();
+
+	return 0;
+}
+
+int fbterm_brcall_set_bgcolor(struct robject *self, rp_t source, int argc, struct brcall_arg *argv) {
+
+	screen.bg = argv[0].i;
+	screen_sync();
+
+	return 0;
+}
+
 void fbterm_key_event(rp_t source, int argc, char **argv) {
 	
 	if (argc != 3) return;
@@ -137,7 +153,7 @@ int main(int argc, char **argv) {
 
 	term = rdi_file_cons(robject_new_index(), ACCS_READ | ACCS_WRITE);
 	
-	robject_set_data(term, "type", (void*) "term");
+	robject_set_type(term, "term");
 
 	if (argc < 3) {
 		wmanager = fs_find("/sys/wmanager");
@@ -188,6 +204,8 @@ int main(int argc, char **argv) {
 	robject_set_call(term, "set_fgjob",   fbterm_rcall_set_fgjob,   AC_WRITE);
 	robject_set_call(term, "set_fgcolor", fbterm_rcall_set_fgcolor, AC_WRITE);
 	robject_set_call(term, "set_bgcolor", fbterm_rcall_set_bgcolor, AC_WRITE);
+	robject_set_brcall(term, BRCALL_SET_FGCOLOR, "i", fbterm_brcall_set_fgcolor, AC_WRITE);
+	robject_set_brcall(term, BRCALL_SET_BGCOLOR, "i", fbterm_brcall_set_bgcolor, AC_WRITE);
 	rdi_global_read_hook  = fbterm_read;
 	rdi_global_write_hook = fbterm_write;
 
@@ -142,6 +142,9 @@ int main(int argc, char **argv) {
 
 	mouse = rdi_file_cons(robject_new_index(), ACCS_READ | ACCS_EVENT);
 
+	// deltas arrive at interrupt rate; deliver their sum
+	robject_event_coalesce("mouse delta", robject_coalesce_sum);
+
 #if USE_IRQ
 	rdi_set_irq(12, mouse_irq);
 #endif
@@ -39,17 +39,6 @@ struct pipe {
 	struct pipe_node *back;
 };
 
-static struct pipe *pipe_new(void) {
-	struct pipe *pipe;
-
-	pipe = malloc(sizeof(struct pipe));
-	pipe->mutex = false;
-	pipe->front = NULL;
-	pipe->back  = NULL;
-
-	return pipe;
-}
-
 static int pipe_getc(struct pipe *pipe) {
 	struct pipe_node *node;
 	int datum;
@@ -96,7 +85,8 @@ size_t pipe_read(struct robject *self, rp_t source, uint8_t *buffer, size_t size
 	int datum;
 	size_t i;
 
-	pipe = robject_data(self, "pipe");
+	pipe = self->priv;
+	if (!pipe) return 0;
 
 	for (i = 0; i < size; i++) {
 		datum = pipe_getc(pipe);
@@ -125,7 +115,8 @@ size_t pipe_write(struct robject *self, rp_t source, uint8_t *buffer, size_t siz
 	struct pipe *pipe;
 	size_t i;
 
-	pipe = robject_data(self, "pipe");
+	pipe = self->priv;
+	if (!pipe) return 0;
 	
 	for (i = 0; i < size; i++) {
 		pipe_putc(pipe, buffer[i]);
@@ -135,14 +126,9 @@ size_t pipe_write(struct robject *self, rp_t source, uint8_t *buffer, size_t siz
 }
 
 struct robject *pipe_file_cons(rp_t source, int argc, char **argv) {
-	struct robject *new_r;
-	struct pipe *pipe;
-
-	new_r = rdi_file_cons(robject_new_index(), ACCS_READ | ACCS_WRITE);
-	pipe = pipe_new();
-	robject_set_data(new_r, "pipe", pipe);
 
-	return new_r;
+	// the pipe lives in the robject's private area, zeroed (empty) at birth
+	return rdi_file_cons_priv(robject_new_index(), ACCS_READ | ACCS_WRITE, sizeof(struct pipe));
 }
 
 int main(int argc, char **argv) {
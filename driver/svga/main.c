@@ -45,7 +45,7 @@ char *svga_rcall_unshare(struct robject *self, rp_t source, int argc, char **arg
 
 	mutex_spin(&self->driver_mutex);
 	page_free(buffer, msize(buffer));
-	free(buffer);
+	free_unmapped(buffer);
 	buffer = valloc(svga.w * svga.h * 4);
 	mutex_free(&self->driver_mutex);
 
@@ -66,7 +66,7 @@ char *svga_rcall_setmode(struct robject *self, rp_t source, int argc, char **arg
 	mode = svga_find_mode(x, y, d);
 	if (svga_set_mode(mode)) return NULL;
 	page_free(buffer, msize(buffer));
-	free(buffer);
+	free_unmapped(buffer);
 	buffer = valloc(svga.w * svga.h * 4);
 	mutex_free(&self->driver_mutex);
 
@@ -90,6 +90,15 @@ char *svga_rcall_syncrect(struct robject *self, rp_t source, int argc, char **ar
 	return strdup("T");
 }
 
+int svga_brcall_syncrect(struct robject *self, rp_t source, int argc, struct brcall_arg *argv) {
+
+	mutex_spin(&self->driver_mutex);
+	svga_fliprect(buffer, argv[0].i, argv[1].i, argv[2].i, argv[3].i);
+	mutex_free(&self->driver_mutex);
+
+	return 0;
+}
+
 char *svga_rcall_sync(struct robject *self, rp_t source, int argc, char **argv) {
 	svga_flip(buffer);
 	return strdup("T");
@@ -106,7 +115,7 @@ int svga_share(struct robject *self, rp_t source, uint8_t *_buffer, size_t size,
 
 	if (buffer) {
 		page_free(buffer, msize(buffer));
-		free(buffer);
+		free_unmapped(buffer);
 	}
 
 	buffer = (uint32_t*) _buffer;
@@ -140,7 +149,10 @@ int main(int argc, char **argv) {
 	rdi_init();
 
 	canvas = rdi_file_cons(robject_new_index(), ACCS_READ | ACCS_WRITE | ACCS_EVENT);
-	robject_set_data(canvas, "type", (void*) "canvas share");
+	robject_set_type(canvas, "canvas share");
+
+	// only the final mode matters to subscribers
+	robject_event_coalesce("graph resize", robject_coalesce_last);
 
 	svga_init();
 
@@ -164,6 +176,7 @@ int main(int argc, char **argv) {
 	robject_set_call(canvas, "setmode",   svga_rcall_setmode,   AC_WRITE);
 	robject_set_call(canvas, "syncrect",  svga_rcall_syncrect,  AC_WRITE);
 	robject_set_call(canvas, "sync",      svga_rcall_sync,      AC_WRITE);
+	robject_set_brcall(canvas, BRCALL_SYNCRECT, "iiii", svga_brcall_syncrect, AC_WRITE);
 	rdi_global_share_hook = svga_share;
 	rdi_global_mmap_hook  = svga_mmap;
 
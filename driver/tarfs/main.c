@@ -47,6 +47,17 @@ struct tar_block {
 	char linkname[100];
 };
 
+/****************************************************************************
+ * tarfs_file
+ *
+ * Per-file private data, kept in the robject's private area. The file size
+ * is the robject's own size field.
+ */
+
+struct tarfs_file {
+	off_t poff; /* offset of file contents in parent */
+};
+
 /****************************************************************************
  * getvalue
  *
@@ -72,23 +83,19 @@ struct robject *tarfs_link_cons(rp_t source, int argc, char **argv) {
 }
 
 size_t tarfs_read(struct robject *self, rp_t source, uint8_t *buffer, size_t size, off_t offset) {
-	off_t *file_size;
-	off_t *file_poff;
-
-	file_size = robject_data(self, "size");
-	file_poff = robject_data(self, "parent-offset");
+	struct tarfs_file *file = self->priv;
 
-	if (!file_size || !file_poff) return 0;
+	if (!file) return 0;
 
-	if (offset >= *file_size) {
+	if (offset >= self->size) {
 		return 0;
 	}
 
-	if (offset + size > *file_size) {
-		size = *file_size - offset;
+	if (offset + size > self->size) {
+		size = self->size - offset;
 	}
 
-	fseek(parent, *file_poff + offset, SEEK_SET);
+	fseek(parent, file->poff + offset, SEEK_SET);
 	fread(buffer, 1, size, parent);
 
 	return size;
@@ -107,7 +114,7 @@ int main(int argc, char **argv) {
 	struct robject *root;
 	struct robject *file;
 	size_t i, n;
-	off_t *poff, *size;
+	off_t size;
 
 	/* reject if no parent is speicified */
 	if (argc < 2) {
@@ -158,19 +165,16 @@ int main(int argc, char **argv) {
 		else {
 
 			/* add file to VFS */
-			file = rdi_file_cons(robject_new_index(), ACCS_READ);
+			file = rdi_file_cons_priv(robject_new_index(), ACCS_READ, sizeof(struct tarfs_file));
 			rdi_vfs_add(root, block->filename, file);
 
-			poff = malloc(sizeof(off_t));
-			size = malloc(sizeof(off_t));
-			*poff = i + 512;
-			*size = getvalue(block->filesize, 12);
-			robject_set_data(file, "size", size);
-			robject_set_data(file, "parent-offset", poff);
+			size = getvalue(block->filesize, 12);
+			((struct tarfs_file*) file->priv)->poff = i + 512;
+			file->size = size;
 			
 			/* move to next file header */
-			i += ((*size / 512) + 1) * 512;
-			if (*size % 512) i += 512;
+			i += ((size / 512) + 1) * 512;
+			if (size % 512) i += 512;
 		}
 	}
 
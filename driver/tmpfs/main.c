@@ -16,6 +16,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 
 #include <rho/mutex.h>
 #include <rho/proc.h>
@@ -24,67 +25,74 @@
 #include <rdi/vfs.h>
 #include <rdi/io.h>
 
-size_t tmpfs_read(struct robject *self, rp_t source, uint8_t *buffer, size_t size, off_t offset) {
-	uint8_t *file_data;
-	off_t *file_size;
+/*
+ * Per-file private data, kept in the robject's private area. The file size
+ * is the robject's own size field.
+ */
 
-	mutex_spin(&self->driver_mutex);
+struct tmpfs_file {
+	uint8_t *data;
+};
 
-	file_data = robject_data(self, "data");
-	file_size = robject_data(self, "size");
+size_t tmpfs_read(struct robject *self, rp_t source, uint8_t *buffer, size_t size, off_t offset) {
+	struct tmpfs_file *file = self->priv;
 
-	if (!file_data || !file_size) {
-		mutex_free(&self->driver_mutex);
-		return 0;
-	}
+	if (!file) return 0;
+
+	mutex_spin(&self->driver_mutex);
 
-	if (offset > *file_size) {
+	if (!file->data || offset > self->size) {
 		mutex_free(&self->driver_mutex);
 		return 0;
 	}
 
-	if (offset + size >= *file_size) {
-		size = *file_size - offset;
+	if (offset + size >= self->size) {
+		size = self->size - offset;
 	}
 
-	memcpy(buffer, &file_data[offset], size);
+	memcpy(buffer, &file->data[offset], size);
 
 	mutex_free(&self->driver_mutex);
 	return size;
 }
 
 size_t tmpfs_write(struct robject *self, rp_t source, uint8_t *buffer, size_t size, off_t offset) {
+	struct tmpfs_file *file = self->priv;
 	uint8_t *file_data;
-	off_t _file_size = 0;
-	off_t *file_size;
+	size_t capacity;
+
+	if (!file) return 0;
 
 	mutex_spin(&self->driver_mutex);
 
-	file_data = robject_data(self, "data");
-	file_size = robject_data(self, "size");
+	if (offset + size >= self->size) {
 
-	if (!file_size) {
-		file_size = &_file_size;
-	}
+		/* grow buffer geometrically, so appending is amortized O(1) */
+		if (offset + size > msize(file->data)) {
+			capacity = msize(file->data) * 2;
+			if (capacity < offset + size) capacity = offset + size;
 
-	if (offset + size >= *file_size) {
-		file_data = realloc(file_data, offset + size);
-		robject_set_data(self, "data", file_data);
-		if (file_size == &_file_size) {
-			file_size = malloc(sizeof(off_t));
+			file_data = realloc(file->data, capacity);
+			if (!file_data) {
+				mutex_free(&self->driver_mutex);
+				return 0;
+			}
+
+			file->data = file_data;
 		}
-		*file_size = offset + size;
-		robject_set_data(self, "size", file_size);
+
+		/* __rdi_write notifies size caches */
+		self->size = offset + size;
 	}
 
-	memcpy(&file_data[offset], buffer, size);
+	memcpy(&file->data[offset], buffer, size);
 
 	mutex_free(&self->driver_mutex);
 	return size;
 }
 
 struct robject *tmpfs_file_cons(rp_t source, int argc, char **argv) {
-	return rdi_file_cons(robject_new_index(), ACCS_READ | ACCS_WRITE);
+	return rdi_file_cons_priv(robject_new_index(), ACCS_READ | ACCS_WRITE, sizeof(struct tmpfs_file));
 }
 
 struct robject *tmpfs_dir_cons(rp_t source, int argc, char **argv) {
@@ -96,22 +104,19 @@ struct robject *tmpfs_link_cons(rp_t source, int argc, char **argv) {
 }
 
 char *tmpfs_reset(struct robject *self, rp_t source, int argc, char **argv) {
-	uint8_t *file_data;
-	off_t *file_size;
-
-	mutex_spin(&self->driver_mutex);
+	struct tmpfs_file *file = self->priv;
 
-	file_data = robject_data(self, "data");
-	file_size = robject_data(self, "size");
+	if (!file) return errorstr(ENOSYS);
 
-	free(file_data);
-	free(file_size);
+	mutex_spin(&self->driver_mutex);
 
-	robject_set_data(self, "data", NULL);
-	robject_set_data(self, "size", NULL);
+	free(file->data);
+	file->data = NULL;
 
 	mutex_free(&self->driver_mutex);
 
+	robject_set_size(self, 0);
+
 	return strdup("T");
 }
 
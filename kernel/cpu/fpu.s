@@ -1,4 +1,4 @@
-; Copyright (C) 2009-2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+; Copyright (C) 2009-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
 ; 
 ; Permission to use, copy, modify, and distribute this software for any
 ; purpose with or without fee is hereby granted, provided that the above
@@ -17,10 +17,14 @@
 section .data
 
 global can_use_fpu
+global can_use_fxsr
 
 can_use_fpu: 
 	dd 0
 
+can_use_fxsr:
+	dd 0
+
 section .text
 
 global cpu_init_fpu
@@ -40,7 +44,15 @@ cpu_init_fpu:
 	or eax,  0x00000022 ; set MP, NS
 	mov cr0, eax
 
-	; initialize SSE
+	; initialize SSE, if FXSAVE/FXRSTOR can preserve its state
+	mov eax, 1
+	cpuid
+	test edx, 0x01000000 ; FXSR
+	jz .nofpu
+
+	mov eax, 1
+	mov [can_use_fxsr], eax
+
 	mov eax, cr4
 	or eax,  0x00000600 ; set OSFXR, OSXMMEXCPT
 	mov cr4, eax
@@ -54,6 +66,12 @@ fpu_save:
 	cmp eax, 0
 	je .blank
 	mov ecx, [esp+4]
+	mov eax, [can_use_fxsr]
+	cmp eax, 0
+	je .fsave
+	fxsave [ecx]
+	ret
+.fsave:
 	fsave [ecx]
 .blank:
 	ret
@@ -63,6 +81,12 @@ fpu_load:
 	cmp eax, 0
 	je .blank
 	mov ecx, [esp+4]
+	mov eax, [can_use_fxsr]
+	cmp eax, 0
+	je .frstor
+	fxrstor [ecx]
+	ret
+.frstor:
 	frstor [ecx]
 .blank:
 	ret
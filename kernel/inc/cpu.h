@@ -46,7 +46,7 @@ uint32_t cpu_get_cr2   (void);
 uint32_t cpu_get_cr3   (void);
 uint32_t cpu_get_eflags(void);
 uint32_t cpu_get_id    (uint32_t selector);
-uint32_t cpu_get_tsc   (void);
+uint64_t cpu_get_tsc   (void);
 
 void cpu_set_ts(void);
 void cpu_clr_ts(void);
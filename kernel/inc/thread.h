@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009-2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2009-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -77,6 +77,9 @@ struct thread {
 	struct thread *next;
 	uint32_t frozen;
 
+	/* set if the message that created this thread was traced */
+	uint32_t traced;
+
 } __attribute__ ((packed));
 
 /* thread operations *******************************************************/
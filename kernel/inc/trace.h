@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2012 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * 
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef KERNEL_TRACE_H
+#define KERNEL_TRACE_H
+
+#include <stdint.h>
+#include <types.h>
+
+/* IPC trace buffer *********************************************************/
+
+#define TRACE_SIZE	1024	/* records in ring buffer (power of two) */
+
+#define TRACE_SEND	1		/* message sent; handler thread created */
+#define TRACE_EXIT	2		/* handler thread exited */
+
+struct trace {
+	uint64_t tsc;
+	uint16_t type;
+	uint16_t port;
+	uint16_t source_pid;
+	uint16_t source_tid;
+	uint16_t target_pid;
+	uint16_t target_tid;
+	uint32_t count;
+} __attribute__ ((packed));
+
+void     trace_log (uint16_t type, pid_t spid, tid_t stid, pid_t tpid, tid_t ttid, 
+	portid_t port, uint32_t count);
+uint32_t trace_read(struct trace *buffer, uint32_t count);
+
+#endif/*KERNEL_TRACE_H*/
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009-2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2009-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -109,6 +109,7 @@ struct process *process_clone(struct process *parent, struct thread *active) {
 
 	/* setup child thread */
 	thread_bind(new_thread, child);
+	new_thread->traced = 0;
 
 	/* add child's thread to the scheduler */
 	schedule_insert(new_thread);
@@ -0,0 +1,41 @@
+; Copyright (C) 2012 Nick Johnson <nickbjohnson4224 at gmail.com>
+; 
+; Permission to use, copy, modify, and distribute this software for any
+; purpose with or without fee is hereby granted, provided that the above
+; copyright notice and this permission notice appear in all copies.
+; 
+; THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+; WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+; MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+; ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+; WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+; ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+; OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+[bits 32]
+
+section .text
+
+; void *memclr(void *s, size_t n)
+;
+; Clears <n> bytes at <s> a dword at a time, with the remaining bytes 
+; cleared individually.
+
+global memclr
+memclr:
+	push edi
+
+	mov edi, [esp+8]
+	mov edx, [esp+12]
+
+	xor eax, eax
+	mov ecx, edx
+	shr ecx, 2
+	rep stosd
+	mov ecx, edx
+	and ecx, 3
+	rep stosb
+
+	mov eax, [esp+8]
+	pop edi
+	ret
@@ -1,39 +0,0 @@
-/*
- * Copyright (C) 2009, 2010 Nick Johnson <nickbjohnson4224 at gmail.com>
- * 
- * Permission to use, copy, modify, and distribute this software for any
- * purpose with or without fee is hereby granted, provided that the above
- * copyright notice and this permission notice appear in all copies.
- * 
- * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
- * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
- * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
- * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
- * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
- * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
- * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
- */
-
-#include <string.h>
-
-void *memmove(void *d, const void *s, size_t n) {
-	size_t i;
-	uint8_t *dst = (uint8_t*) d;
-	uint8_t *src = (uint8_t*) s;
-
-	if (src == dst) {
-		return dst;
-	}
-	else if (src > dst) {
-		for (i = 0; i < n; i++) {
-			dst[i] = src[i];
-		}
-	}
-	else if (src < dst) {
-		for (i = 0; i < n; i++) {
-			dst[n - i - 1] = src[n - i - 1];
-		}
-	}
-
-	return dst;
-} 
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2012 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * 
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <process.h>
+#include <thread.h>
+#include <space.h>
+#include <trace.h>
+
+/****************************************************************************
+ * syscall_trce (int 0x56)
+ *
+ * EBX: buffer
+ * ECX: count
+ *
+ * Drains up to <count> records from the kernel IPC trace buffer into the
+ * array of trace records at <buffer>. Only threads with user id zero may
+ * read the trace buffer. Every page of <buffer> must be present, writable
+ * and not copy-on-write, or the call is rejected.
+ *
+ * Returns the number of records copied, or -1 on failure.
+ */
+
+struct thread *syscall_trce(struct thread *image) {
+	uintptr_t buffer = image->ebx;
+	uintptr_t count  = image->ecx;
+	uintptr_t size, addr;
+	uint32_t  flags;
+
+	/* only root may drain the trace buffer */
+	if (image->user != 0) {
+		image->eax = -1;
+		return image;
+	}
+
+	/* clamp request to the size of the ring */
+	if (count > TRACE_SIZE) {
+		count = TRACE_SIZE;
+	}
+
+	size = count * sizeof(struct trace);
+
+	/* bounds check region */
+	if (buffer >= KSPACE || buffer + size >= KSPACE || buffer + size < buffer) {
+		image->eax = -1;
+		return image;
+	}
+
+	/* verify that region is present and writable */
+	for (addr = buffer & ~0xFFF; addr < buffer + size; addr += PAGESZ) {
+		flags = page_get(addr);
+
+		if ((flags & (PF_PRES | PF_RW | PF_USER)) != (PF_PRES | PF_RW | PF_USER)
+				|| (flags & PF_COW)) {
+			image->eax = -1;
+			return image;
+		}
+	}
+
+	image->eax = trace_read((void*) buffer, count);
+
+	return image;
+}
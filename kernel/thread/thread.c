@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009-2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2009-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -16,6 +16,8 @@
 
 #include <process.h>
 #include <thread.h>
+#include <string.h>
+#include <trace.h>
 #include <space.h>
 #include <debug.h>
 #include <timer.h>
@@ -44,6 +46,14 @@ struct thread *thread_alloc(void) {
 	thread = heap_alloc(sizeof(struct thread));
 	thread->fxdata = heap_alloc(512);
 
+	/* start with a clean FPU/SSE state, valid for FRSTOR and FXRSTOR */
+	if (thread->fxdata) {
+		memclr(thread->fxdata, 512);
+		((uint16_t*) thread->fxdata)[0] = 0x037F; // FCW: default control
+		((uint16_t*) thread->fxdata)[4] = 0xFFFF; // FTW (FSAVE): all empty
+		((uint32_t*) thread->fxdata)[6] = 0x1F80; // MXCSR: default control
+	}
+
 	return thread;
 }
 
@@ -54,6 +64,12 @@ struct thread *thread_alloc(void) {
  */
 
 struct thread *thread_exit(struct thread *image) {
+
+	/* only handler threads whose creation was traced log their exit */
+	if (image->traced) {
+		trace_log(TRACE_EXIT, 0, 0, image->proc->pid, image->id, 0, 0);
+	}
+
 	thread_free(image);
 
 	return thread_switch(NULL, schedule_next());
@@ -105,6 +121,12 @@ struct thread *thread_send(struct thread *image, pid_t target, portid_t port, st
 	/* set new thread's user id */
 	new_image->user = (!image || p_targ->user) ? p_targ->user : image->user;
 
+	/* record message in IPC trace buffer */
+	trace_log(TRACE_SEND, 
+		(image) ? image->proc->pid : 0, (image) ? image->id : 0,
+		p_targ->pid, new_image->id, port, (msg) ? msg->count : 0);
+	new_image->traced = 1;
+
 	/* insert new thread into scheduler */
 	schedule_insert(new_image);
 
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2012 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * 
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <trace.h>
+#include <string.h>
+#include <cpu.h>
+
+/****************************************************************************
+ * trace_ring
+ *
+ * Fixed-size ring buffer of IPC trace records. <trace_head> is the total
+ * number of records ever logged; <trace_tail> is the total number of records
+ * ever drained. If the ring overflows, the oldest records are overwritten
+ * and the tail is pushed forward to match.
+ */
+
+static struct trace trace_ring[TRACE_SIZE];
+static uint32_t trace_head;
+static uint32_t trace_tail;
+
+/****************************************************************************
+ * trace_log
+ *
+ * Appends a record to the IPC trace buffer, stamped with the current value 
+ * of the TSC. This is called with interrupts disabled, so no locking is
+ * needed.
+ */
+
+void trace_log(uint16_t type, pid_t spid, tid_t stid, pid_t tpid, tid_t ttid, 
+		portid_t port, uint32_t count) {
+	struct trace *t;
+
+	t = &trace_ring[trace_head % TRACE_SIZE];
+	t->tsc        = cpu_get_tsc();
+	t->type       = type;
+	t->port       = port;
+	t->source_pid = spid;
+	t->source_tid = stid;
+	t->target_pid = tpid;
+	t->target_tid = ttid;
+	t->count      = count;
+
+	trace_head++;
+
+	if (trace_head - trace_tail > TRACE_SIZE) {
+		trace_tail = trace_head - TRACE_SIZE;
+	}
+}
+
+/****************************************************************************
+ * trace_read
+ *
+ * Moves up to <count> of the oldest undrained records from the IPC trace 
+ * buffer into <buffer>. Returns the number of records copied.
+ */
+
+uint32_t trace_read(struct trace *buffer, uint32_t count) {
+	uint32_t i;
+
+	for (i = 0; i < count && trace_tail != trace_head; i++, trace_tail++) {
+		memcpy(&buffer[i], &trace_ring[trace_tail % TRACE_SIZE], sizeof(struct trace));
+	}
+
+	return i;
+}
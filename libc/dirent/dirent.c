@@ -36,16 +36,33 @@ DIR *opendir(const char *dirname) {
 		return NULL;
 	}
 
+	dirp->dirpos = 0;
+	dirp->entryv = NULL;
+	dirp->entryx = rp_listx(fd_rp(dirp->fd), &dirp->entryc);
+
+	if (dirp->entryx) {
+		return dirp;
+	}
+
+	if (errno != ENOSYS) {
+		close(dirp->fd);
+		free(dirp);
+		return NULL;
+	}
+
+	// driver does not support listx; fall back to a plain name list
 	list = rp_list(fd_rp(dirp->fd));
 
 	dirp->entryv = strparse(list, "\t");
+	free(list);
 
 	if (!dirp->entryv) {
+		close(dirp->fd);
 		free(dirp);
 		return NULL;
 	}
 
-	dirp->dirpos = 0;
+	for (dirp->entryc = 0; dirp->entryv[dirp->entryc]; dirp->entryc++);
 
 	return dirp;
 }
@@ -64,36 +81,14 @@ int closedir(DIR *dirp) {
 		free(dirp->entryv);
 	}
 
+	free(dirp->entryx);
+
 	close(dirp->fd);
 	free(dirp);
 
 	return 0;
 }
 
-struct dirent *readdir(DIR *dirp) {
-	static struct dirent dirent;
-
-	if (!dirp) {
-		return NULL;
-	}
-
-	if (dirp->fd < 0) {
-		errno = EBADF;
-		return NULL;
-	}
-
-	if (!dirp->entryv[dirp->dirpos]) {
-		return NULL;
-	}
-
-	strlcpy(dirent.d_name, dirp->entryv[dirp->dirpos], NAME_MAX);
-	dirent.d_ino = rp_find(fd_rp(dirp->fd), dirp->entryv[dirp->dirpos]);
-
-	dirp->dirpos++;
-
-	return &dirent;
-}
-
 int readdir_r(DIR *dirp, struct dirent *entry, struct dirent **result) {
 	
 	if (!dirp) {
@@ -105,12 +100,18 @@ int readdir_r(DIR *dirp, struct dirent *entry, struct dirent **result) {
 		return -1;
 	}
 
-	if (!dirp->entryv[dirp->dirpos]) {
+	if (dirp->dirpos >= dirp->entryc) {
 		return -1;
 	}
 
-	strlcpy(entry->d_name, dirp->entryv[dirp->dirpos], NAME_MAX);
-	entry->d_ino = rp_find(fd_rp(dirp->fd), dirp->entryv[dirp->dirpos]);
+	if (dirp->entryx) {
+		strlcpy(entry->d_name, dirp->entryx[dirp->dirpos].name, NAME_MAX);
+		entry->d_ino = dirp->entryx[dirp->dirpos].rp;
+	}
+	else {
+		strlcpy(entry->d_name, dirp->entryv[dirp->dirpos], NAME_MAX);
+		entry->d_ino = rp_find(fd_rp(dirp->fd), dirp->entryv[dirp->dirpos]);
+	}
 
 	dirp->dirpos++;
 
@@ -121,6 +122,16 @@ int readdir_r(DIR *dirp, struct dirent *entry, struct dirent **result) {
 	return 0;
 }
 
+struct dirent *readdir(DIR *dirp) {
+	static struct dirent dirent;
+
+	if (readdir_r(dirp, &dirent, NULL)) {
+		return NULL;
+	}
+
+	return &dirent;
+}
+
 void rewinddir(DIR *dirp) {
 	
 	if (dirp) {
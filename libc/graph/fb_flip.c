@@ -17,6 +17,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <errno.h>
 
 #include <rho/natio.h>
 #include <rho/graph.h>
@@ -31,6 +32,7 @@
 
 int fb_flip(struct fb *fb) {
 	char *ret;
+	int err;
 
 	if (!fb) {
 		return 1;
@@ -46,13 +48,23 @@ int fb_flip(struct fb *fb) {
 
 	if (fb->flags & FB_SHARED) {
 		// shared: just sync
-		ret = frcall(fb->fd, AC_WRITE, "syncrect %d %d %d %d",
+		err = fbrcall(fb->fd, AC_WRITE, BRCALL_SYNCRECT, "iiii",
 			fb->minx, fb->miny, fb->maxx - fb->minx, fb->maxy - fb->miny);
-		if (!ret || !strcmp(ret, "")) {
+
+		if (err == -ENOSYS) {
+			// device does not speak binary rcall: use the string form
+			ret = frcall(fb->fd, AC_WRITE, "syncrect %d %d %d %d",
+				fb->minx, fb->miny, fb->maxx - fb->minx, fb->maxy - fb->miny);
+			if (!ret || !strcmp(ret, "")) {
+				mutex_free(&fb->mutex);
+				return 1;
+			}
+			free(ret);
+		}
+		else if (err < 0) {
 			mutex_free(&fb->mutex);
 			return 1;
 		}
-		free(ret);
 	}
 	else {
 		// not shared: write whole buffer
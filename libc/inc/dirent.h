@@ -24,7 +24,9 @@
 typedef struct _dir {
 	int fd;
 	size_t dirpos;
-	char **entryv;
+	size_t entryc;
+	struct rp_dirent *entryx; /* from listx, if the driver supports it */
+	char **entryv;            /* from list otherwise */
 } DIR;
 
 /* directory entry structure ************************************************/
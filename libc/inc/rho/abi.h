@@ -70,6 +70,8 @@ uint32_t kcall(uint32_t call, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3
 
 /* system calls *******************************************************/
 
+struct _trace;
+
 int			_send(uintptr_t base, size_t count, uint8_t port, uint32_t target);
 void		_done(void) __attribute__ ((noreturn));
 void		_when(uintptr_t entry);
@@ -88,6 +90,7 @@ int         _proc(uint32_t pid, uint32_t selector, uint32_t value);
 int         _kill(uint32_t target, uint8_t signal);
 int         _name(char *name, uint32_t pid, uint32_t operation);
 uint32_t    _reap(uint32_t pid);
+int         _trce(struct _trace *buffer, size_t count);
 
 #define GPID_SELF	0
 #define GPID_PARENT	1
@@ -107,4 +110,20 @@ uint32_t    _reap(uint32_t pid);
 #define PROC_READ_UID	2
 #define PROC_WRITE_UID	3
 
+/* IPC trace records (_trce) ******************************************/
+
+#define TRACE_SEND	1
+#define TRACE_EXIT	2
+
+struct _trace {
+	uint64_t tsc;
+	uint16_t type;
+	uint16_t port;
+	uint16_t source_pid;
+	uint16_t source_tid;
+	uint16_t target_pid;
+	uint16_t target_tid;
+	uint32_t count;
+} __attribute__ ((packed));
+
 #endif/*__RLIBC_ABI_H*/
@@ -54,6 +54,7 @@
 #define ACTION_CLOSE  24
 #define ACTION_MMAP   25
 #define ACTION_FINISH 26
+#define ACTION_BRCALL 27
 
 /* message structure ********************************************************/
 
@@ -78,6 +79,15 @@ int         mqueue_push(struct msg *msg);
 struct msg *mqueue_pull(uint8_t port, uint64_t source);
 struct msg *mqueue_wait(uint8_t port, uint64_t source);
 
+struct mqueue_stat {
+	uint32_t depth; // messages currently queued
+	uint32_t peak;  // most messages ever queued at once
+	uint32_t total; // messages ever queued
+};
+
+int      mqueue_stat (uint8_t port, struct mqueue_stat *stat);
+uint32_t mqueue_depth(uint8_t port);
+
 void mqueue_set_policy(uint8_t port, bool do_queue);
 
 /* sending and recieving ****************************************************/
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009, 2010 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2009-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -18,6 +18,7 @@
 #define __RLIBC_MUTEX_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 bool mutex_lock(bool *mutex);
 bool mutex_test(bool *mutex);
@@ -25,4 +26,20 @@ void mutex_spin(bool *mutex);
 void mutex_wait(bool *mutex);
 void mutex_free(bool *mutex);
 
+/* reader/writer locks *****************************************************/
+
+/* note: a reader/writer lock is a uint32_t that is zero when free. Any 
+ * number of readers may hold it at once; a waiting writer keeps new readers
+ * out, so a thread must never take a read lock it already holds. */
+
+bool rwlock_rtry (uint32_t *lock);
+void rwlock_rspin(uint32_t *lock);
+void rwlock_rfree(uint32_t *lock);
+
+bool rwlock_wtry (uint32_t *lock);
+void rwlock_wspin(uint32_t *lock);
+void rwlock_wfree(uint32_t *lock);
+
+void __rwlock_wflag(uint32_t *lock);
+
 #endif/*__RLIBC_MUTEX_H*/
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009-2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2009-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -53,6 +53,22 @@ rp_t  rp_find (rp_t dir, const char *path);
 rp_t  rp_findl(rp_t dir, const char *path);
 char *rp_list (rp_t dir);
 
+/* path resolution cache (see dcache.c) */
+char    *dcache_get  (rp_t root, const char *path, int link);
+void     dcache_put  (rp_t root, const char *path, int link, const char *reply, uint32_t gen);
+uint32_t dcache_gen  (void);
+void     dcache_flush(uint32_t pid);
+
+/* directory listing with entry metadata (see rp_listx) */
+struct rp_dirent {
+	const char *name;
+	const char *type;
+	rp_t  rp;
+	off_t size;
+};
+
+struct rp_dirent *rp_listx(rp_t dir, size_t *count);
+
 /* file descriptor operations ***********************************************/
 
 int open(const char *pathname, int flags);
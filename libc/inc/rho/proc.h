@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009-2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2009-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -60,6 +60,13 @@ uintptr_t gettls (void);
 uint32_t  getparent(uint32_t pid);
 int       setparent(uint32_t pid, uint32_t ppid);
 
+/* thread-local segment layout *********************************************/
+
+/* note: the stack grows down from the top of the segment returned by gettls;
+ * the bottom of the segment is reserved for per-thread libc state */
+#define TLS_RAND	0x0000	/* rand() generator state */
+#define TLS_LIBC	0x1000	/* end of reserved area */
+
 /* users and authorization *************************************************/
 
 uint32_t  getuser(uint32_t pid);
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2011-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -48,4 +48,44 @@ void           *s_table_getv(struct s_table *table, const char *field, ...);
 void            s_table_free(struct s_table *table);
 void            s_table_iter(struct s_table *table, void *arg0, void (*iter)(void *, const char*, void*));
 
+/*****************************************************************************
+ * Open-Addressing Lookup Table
+ *
+ * Maps 32-bit integer keys (or pointers, or atoms) to non-null data. 
+ * Setting a key to null removes it. The table may be reallocated by any
+ * set operation, so the returned pointer must always be used.
+ */
+
+struct s_map_entry {
+	uint32_t hash; // hash of key (never zero); zero if slot is empty
+	uint32_t key;
+	void *data;
+};
+
+struct s_map {
+	size_t size; // real size is (1 << size)
+	size_t load;
+	struct s_map_entry table[];
+};
+
+struct s_map *s_map_set (struct s_map *map, uint32_t key, void *data);
+void         *s_map_get (struct s_map *map, uint32_t key);
+
+struct s_map *s_map_setp(struct s_map *map, const void *key, void *data);
+void         *s_map_getp(struct s_map *map, const void *key);
+
+void          s_map_free(struct s_map *map);
+void          s_map_iter(struct s_map *map, void *arg0, void (*iter)(void *, uint32_t, void *));
+
+/*****************************************************************************
+ * Atoms (Interned Strings)
+ *
+ * An atom is a nonzero integer standing for a string, for use as an s_map 
+ * key. Equal strings always have the same atom.
+ */
+
+uint32_t    s_atom     (const char *string);
+uint32_t    s_atom_find(const char *string);
+const char *s_atom_name(uint32_t atom);
+
 #endif/*__RLIBC_STRUCT_H*/
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2011-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -21,6 +21,8 @@
 #include <rho/proc.h>
 #include <rho/types.h>
 
+struct msg;
+
 /*****************************************************************************
  * Resource pointers
  *
@@ -89,6 +91,9 @@ int  fd_mode   (int fd);
 rp_t fd_rp     (int fd);
 int  fd_free   (int fd);
 
+// advanced whenever a file descriptor is changed
+extern volatile uint32_t fdtab_gen;
+
 int      fd_seek(int fd, uint64_t pos);
 uint64_t fd_pos (int fd);
 
@@ -248,6 +253,11 @@ int rp_admin (rp_t rp, uint32_t user, int access);
 char *rcall (rp_t rp, rk_t key, const char *fmt, ...);
 char *frcall(int fd, int aclass, const char *fmt, ...);
 
+// perform an idempotent rcall, caching the result until the resource changes
+char *rcall_cached(rp_t rp, rk_t key, const char *fmt, ...);
+void  rcache_flush(rp_t rp);
+void  __rcache_hook(void);
+
 // root rcall hook format
 typedef char *(*rcall_hook_t)(rp_t src, int argc, char **argv);
 
@@ -256,6 +266,47 @@ int    rcall_hook(const char *func, rcall_hook_t hook);
 char  *rcall_call(rp_t source, const char *args);
 void __rcall_init(void);
 
+/*****************************************************************************
+ * Binary Remote Procedure Calls (brcall)
+ *
+ * For calls that are made very frequently (once per frame or keystroke), the
+ * cost of formatting and parsing rcall strings dominates. The binary rcall
+ * protocol identifies methods by a numeric ID instead of a name, and passes
+ * a small, fixed signature of typed arguments packed directly into the 
+ * message payload. The signature is a string of type characters:
+ *
+ *   'i' - int32_t
+ *   'r' - rp_t
+ *   'b' - byte blob (passed as a const void * followed by a size_t)
+ *
+ * The only return value is an integer. Negative return values are negated
+ * errno codes: -ENOSYS if the method does not exist, -EINVAL if the 
+ * signature does not match the one the method was registered with, -EACCES
+ * if the key is wrong, and -EIO if the message could not be sent.
+ */
+
+#define BRCALL_MAXARG 8
+
+// well-known method IDs
+#define BRCALL_SYNCRECT    1 // "iiii": x, y, width, height
+#define BRCALL_SET_FGCOLOR 2 // "i": color
+#define BRCALL_SET_BGCOLOR 3 // "i": color
+
+struct brcall_arg {
+	char type;        // signature character
+	int32_t i;        // value of 'i' arguments
+	rp_t rp;          // value of 'r' arguments
+	const void *blob; // contents of 'b' arguments
+	uint32_t size;    // size of 'b' arguments
+};
+
+// perform a binary rcall
+int brcall (rp_t rp, rk_t key, uint32_t method, const char *sig, ...);
+int fbrcall(int fd, int aclass, uint32_t method, const char *sig, ...);
+
+// unpack a binary rcall request; returns the argument count or -1 on error
+int brcall_unpack(struct msg *msg, uint32_t *method, char *sig, struct brcall_arg *argv);
+
 /**************************************************************************** 
  * High Level Event System (event)
  *
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009-2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2009-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -41,10 +41,16 @@ typedef struct _file {
 	uint8_t *buffer;   // Stream buffer
 	size_t buffpos;    // Position in stream buffer
 	size_t buffsize;   // Size of stream buffer
+	size_t bufflen;    // Read-ahead data in stream buffer (0 if writing)
 
 	int revbuf;        // ungetc() reverse buffer
 
 	uint8_t flags;     // EOF/Error/various flags
+
+	rp_t rp;           // Cached resource pointer of fd (see __fcache)
+	rk_t rkey;         // Cached read key of fd
+	rk_t wkey;         // Cached write key of fd
+	uint32_t fdgen;    // fdtab_gen when the above were cached
 } FILE;
 
 #define FILE_EOF    0x01    // End Of File
@@ -120,7 +126,20 @@ int puts(const char *s);
 
 /* formatted input/output **************************************************/
 
-char *__format(const char **fmt, va_list *argp);
+void   __fcache(FILE *stream);
+int    __fflush(FILE *stream);
+size_t __fwrite(const void *ptr, size_t count, FILE *stream);
+
+/* formatted output sink - receives the output of __vformat() */
+struct __sink {
+	int  (*write)(struct __sink *sink, const char *data, size_t size);
+	void  *data;       // sink-specific state (stream, buffer)
+	size_t size;       // capacity of buffer, if any
+	size_t count;      // characters emitted so far
+	int    error;      // set if a write failed
+};
+
+int __vformat(struct __sink *sink, const char *format, va_list ap);
 
 int printf   (const char *format, ...);
 int vprintf  (const char *format, va_list ap);
@@ -128,6 +147,8 @@ int fprintf  (FILE *stream, const char *format, ...);
 int vfprintf (FILE *stream, const char *format, va_list ap);
 int sprintf  (char *str, const char *format, ...);
 int vsprintf (char *str, const char *format, va_list ap);
+int snprintf (char *str, size_t size, const char *format, ...);
+int vsnprintf(char *str, size_t size, const char *format, va_list ap);
 
 char *saprintf (const char *format, ...);
 char *vsaprintf(const char *format, va_list ap);
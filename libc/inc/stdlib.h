@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009-2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2009-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -28,10 +28,47 @@ void   *malloc(size_t size);
 void   *aalloc(size_t size, size_t align);
 size_t msize(void *ptr);
 void   free(void *ptr);
+void   free_unmapped(void *ptr);
 void   *realloc(void *ptr, size_t size);
 
 int posix_memalign(void **ptr, size_t align, size_t size);
 
+/* heap statistics and profiling *******************************************/
+
+#define MSTAT_CLASSES 24
+
+struct mstat {
+	size_t heap;        /* bytes of heap address space in use */
+	size_t mapped;      /* bytes of heap memory mapped */
+	size_t in_use;      /* bytes allocated to blocks */
+	size_t retained;    /* bytes of freed page runs kept mapped */
+	size_t free_runs;   /* number of free (unmapped) page runs */
+	size_t free_bytes;  /* bytes in free (unmapped) page runs */
+	size_t runs;        /* number of allocated page runs */
+	size_t run_bytes;   /* bytes in allocated page runs */
+
+	struct {
+		size_t size;    /* object size */
+		size_t slabs;   /* number of slabs */
+		size_t in_use;  /* allocated objects */
+		size_t free;    /* free objects in slabs */
+		size_t cached;  /* free objects in thread caches */
+	} sizeclass[MSTAT_CLASSES];
+};
+
+int mstat(struct mstat *stat);
+
+struct mprof_site {
+	uintptr_t caller;     /* return address of allocation call */
+	size_t    samples;    /* sampled allocations */
+	size_t    live;       /* sampled allocations not yet freed */
+	size_t    bytes;      /* bytes in sampled allocations */
+	size_t    live_bytes; /* bytes in sampled allocations not yet freed */
+};
+
+void   mprofile     (uint32_t period);
+size_t mprofile_read(struct mprof_site *site, size_t count);
+
 /* type conversion *********************************************************/
 
 int  __digit(char digit, int base);
@@ -61,8 +98,10 @@ void *  srands(uint32_t seed);
 uint32_t rands(void *state);
 void  memrands(void *p, size_t n, void *state);
 
-uint32_t randx(void); // XXX - not implemented
-void  memrandx(void *p, size_t n); // XXX - not implemented
+uint32_t randx(void);
+void  memrandx(void *p, size_t n);
+
+uint64_t __rdtsc(void);
 
 /* environment variables and system ****************************************/
 
@@ -116,4 +155,7 @@ const void *bsearch(const void *key, const void *base, size_t n, size_t size,
 void qsort(void *base, size_t n, size_t size, 
 	int (*cmp)(const void *keyval, const void *datum));
 
+void qsort_mt(void *base, size_t n, size_t size, 
+	int (*cmp)(const void *keyval, const void *datum), size_t threads);
+
 #endif/*__RLIBC_STDLIB_H*/
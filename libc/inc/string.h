@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009-2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2009-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -69,6 +69,19 @@ char **strparse(const char *, const char *);
 
 const char *strerror(int);
 
+/* optimized implementations ***********************************************/
+
+extern int __string_sse2;
+
+void     __string_init(void);
+uint32_t __cpuid(uint32_t leaf);
+
+void  *__memcpy_sse2 (void *, const void *, size_t);
+void  *__memrcpy_sse2(void *, const void *, size_t);
+void  *__memset_sse2 (void *, uint8_t, size_t);
+void  *__memchr_sse2 (const void *, uint8_t, size_t);
+size_t __strlen_sse2 (const char *);
+
 /* string locales ***********************************************************/
 int    strcoll(const char *, const char *);
 size_t strxfrm(char *, const char *, size_t);
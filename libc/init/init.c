@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009-2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2009-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -18,6 +18,7 @@
 #include <string.h>
 #include <signal.h>
 #include <stdio.h>
+#include <errno.h>
 
 #include <rho/layout.h>
 #include <rho/natio.h>
@@ -109,6 +110,62 @@ static char *__type(rp_t source, int argc, char **argv) {
 	return strdup("proc");
 }
 
+/*****************************************************************************
+ * __heapstat
+ *
+ * Default action for "heapstat" rcall. With no arguments, returns heap 
+ * statistics (see mstat()) and any allocation profile (see mprofile()), one
+ * record per line. "heapstat sample <n>" samples every <n>th allocation from
+ * now on, discarding the old profile; "heapstat sample 0" stops sampling.
+ * Only root or a process of the same user may change the sampling rate.
+ */
+
+static char *__heapstat(rp_t source, int argc, char **argv) {
+	struct mprof_site site[64];
+	struct mstat stat;
+	uint32_t user;
+	size_t i, n;
+	char *rets;
+
+	if (argc == 3 && !strcmp(argv[1], "sample")) {
+		user = getuser(RP_PID(source));
+		if (user != 0 && user != getuser(getpid())) {
+			return errorstr(EACCES);
+		}
+
+		mprofile(atoi(argv[2]));
+		return strdup("T");
+	}
+
+	if (argc != 1 || mstat(&stat)) {
+		return NULL;
+	}
+
+	n = mprofile_read(site, 64);
+
+	rets = malloc(128 * (1 + MSTAT_CLASSES + n));
+	if (!rets) return NULL;
+
+	sprintf(rets, "heap %d mapped %d in_use %d retained %d runs %d %d free %d %d\n",
+		stat.heap, stat.mapped, stat.in_use, stat.retained, 
+		stat.runs, stat.run_bytes, stat.free_runs, stat.free_bytes);
+
+	for (i = 0; i < MSTAT_CLASSES; i++) {
+		if (!stat.sizeclass[i].slabs) continue;
+
+		sprintf(&rets[strlen(rets)], "class %d slabs %d in_use %d free %d cached %d\n",
+			stat.sizeclass[i].size, stat.sizeclass[i].slabs, stat.sizeclass[i].in_use,
+			stat.sizeclass[i].free, stat.sizeclass[i].cached);
+	}
+
+	for (i = 0; i < n; i++) {
+		sprintf(&rets[strlen(rets)], "site %x samples %d live %d bytes %d live_bytes %d\n",
+			site[i].caller, site[i].samples, site[i].live, site[i].bytes, site[i].live_bytes);
+	}
+
+	return rets;
+}
+
 void _init(void) {
 	return;
 }
@@ -128,6 +185,9 @@ void __libc_init(int (*_main)(int, char**)) {
 	char **argv;
 	int argc;
 
+	/* select memory and string function implementations */
+	__string_init();
+
 	/* set up SLT if needed */
 	sltreset();
 
@@ -186,6 +246,7 @@ void __libc_init(int (*_main)(int, char**)) {
 	rcall_hook("ping", __ping);
 	rcall_hook("type", __type);
 	rcall_hook("name", __name);
+	rcall_hook("heapstat", __heapstat);
 
 	/* unpack argument list */
 	if (sltget_name("libc.argv")) {
@@ -17,20 +17,51 @@
 #include <stdlib.h>
 
 #include <rho/mutex.h>
+#include <rho/proc.h>
 #include <rho/ipc.h>
 
+/*****************************************************************************
+ * Each action port has its own queue. Every queued message is linked into
+ * two lists: the queue-wide FIFO (used when any source matches) and a FIFO
+ * for its source's hash bucket (used for matching replies). Queue nodes are
+ * taken from a free list, so pushing a message does not call malloc() once
+ * the pool has been warmed up.
+ */
+
+#define MQUEUE_BUCKETS 16
+#define MQUEUE_CHUNK   64
+
 struct mqueue_msg {
 	struct mqueue_msg *next;
 	struct mqueue_msg *prev;
 
+	struct mqueue_msg *bnext;
+	struct mqueue_msg *bprev;
+
 	struct msg *msg;
 };
 
+struct mqueue_bucket {
+	struct mqueue_msg *front;
+	struct mqueue_msg *back;
+};
+
+struct mqueue_waiter {
+	struct mqueue_waiter *next;
+	uint64_t source;
+	volatile bool woken;
+};
+
 struct mqueue {
 	struct mqueue_msg *back;
 	struct mqueue_msg *front;
 
-	uint32_t wl_tid;
+	struct mqueue_bucket bucket[MQUEUE_BUCKETS];
+	struct mqueue_waiter *waiter;
+
+	uint32_t depth;
+	uint32_t peak;
+	uint32_t total;
 
 	bool mutex;
 };
@@ -38,6 +69,78 @@ struct mqueue {
 static struct mqueue mqueue[256];
 static bool   mqueue_policy[256];
 
+static struct mqueue_msg  mqueue_pool_init[MQUEUE_CHUNK];
+static struct mqueue_msg *mqueue_pool;
+static bool mqueue_pool_init_done;
+static bool m_mqueue_pool;
+
+static uint32_t mqueue_hash(uint64_t source) {
+	uint32_t hash = (uint32_t) (source >> 32) ^ (uint32_t) source;
+
+	return (hash ^ (hash >> 8)) % MQUEUE_BUCKETS;
+}
+
+/*****************************************************************************
+ * mqueue_node_alloc
+ *
+ * Take a queue node from the free pool. The pool starts out with a static
+ * chunk of nodes and is refilled a chunk at a time if it runs dry. Returns
+ * NULL if no node could be allocated.
+ */
+
+static struct mqueue_msg *mqueue_node_alloc(void) {
+	struct mqueue_msg *node;
+	struct mqueue_msg *chunk;
+	int i;
+
+	mutex_spin(&m_mqueue_pool);
+
+	if (!mqueue_pool_init_done) {
+		for (i = 0; i < MQUEUE_CHUNK; i++) {
+			mqueue_pool_init[i].next = mqueue_pool;
+			mqueue_pool = &mqueue_pool_init[i];
+		}
+		mqueue_pool_init_done = true;
+	}
+
+	node = mqueue_pool;
+	if (node) {
+		mqueue_pool = node->next;
+		mutex_free(&m_mqueue_pool);
+		return node;
+	}
+
+	mutex_free(&m_mqueue_pool);
+
+	/* refill pool outside of the lock */
+	chunk = malloc(sizeof(struct mqueue_msg) * MQUEUE_CHUNK);
+	if (!chunk) {
+		return NULL;
+	}
+
+	mutex_spin(&m_mqueue_pool);
+	for (i = 1; i < MQUEUE_CHUNK; i++) {
+		chunk[i].next = mqueue_pool;
+		mqueue_pool = &chunk[i];
+	}
+	mutex_free(&m_mqueue_pool);
+
+	return &chunk[0];
+}
+
+/*****************************************************************************
+ * mqueue_node_free
+ *
+ * Return a queue node to the free pool.
+ */
+
+static void mqueue_node_free(struct mqueue_msg *node) {
+	mutex_spin(&m_mqueue_pool);
+	node->next = mqueue_pool;
+	mqueue_pool = node;
+	mutex_free(&m_mqueue_pool);
+}
+
 /*****************************************************************************
  * mqueue_set_policy
  *
@@ -53,17 +156,70 @@ void mqueue_set_policy(uint8_t action, bool do_queue) {
 	mqueue_policy[action] = (do_queue) ? false : true;
 }
 
+/*****************************************************************************
+ * mqueue_find
+ *
+ * Find and unlink the first message in <q> with source <source>, or the 
+ * first message of any source if <source> is zero. The queue's mutex must be
+ * held by the caller. Returns the queue node on success, NULL if there is no
+ * match.
+ */
+
+static struct mqueue_msg *mqueue_find(struct mqueue *q, uint64_t source) {
+	struct mqueue_bucket *bucket;
+	struct mqueue_msg *node;
+
+	if (source) {
+		bucket = &q->bucket[mqueue_hash(source)];
+		for (node = bucket->front; node; node = node->bnext) {
+			if (node->msg->source == source) {
+				break;
+			}
+		}
+	}
+	else {
+		node = q->front;
+	}
+
+	if (!node) {
+		return NULL;
+	}
+
+	if (!source) {
+		bucket = &q->bucket[mqueue_hash(node->msg->source)];
+	}
+
+	if (node->prev) node->prev->next = node->next;
+	else q->front = node->next;
+
+	if (node->next) node->next->prev = node->prev;
+	else q->back = node->prev;
+
+	if (node->bprev) node->bprev->bnext = node->bnext;
+	else bucket->front = node->bnext;
+
+	if (node->bnext) node->bnext->bprev = node->bprev;
+	else bucket->back = node->bprev;
+
+	q->depth--;
+
+	return node;
+}
+
 /*****************************************************************************
  * mqueue_push
  *
  * Add a message to the message queue. The message's header is used to sort
- * it into the proper queue. <msg> may not be NULL. Returns zero on success,
- * nonzero on error.
+ * it into the proper queue. <msg> may not be NULL. Every thread waiting on
+ * that queue for the message's source (or for any source) is woken. Returns 
+ * zero on success, nonzero on error.
  */
 
 int mqueue_push(struct msg *msg) {
+	struct mqueue_waiter *waiter, **prev;
+	struct mqueue_bucket *bucket;
 	struct mqueue_msg *node;
-	uint32_t wl_tid;
+	struct mqueue *q;
 	uint8_t action;
 
 	if (!msg) {
@@ -76,31 +232,53 @@ int mqueue_push(struct msg *msg) {
 		return 0;
 	}
 
-	mutex_spin(&mqueue[action].mutex);
-
-	node = malloc(sizeof(struct mqueue_msg));
+	node = mqueue_node_alloc();
 
 	if (!node) {
 		return 1;
 	}
-	
-	node->next = NULL;
-	node->prev = mqueue[action].back;
-	node->msg  = msg;
-
-	if (!mqueue[action].front) mqueue[action].front = node;
-	if (mqueue[action].back)   mqueue[action].back->next = node;
-	mqueue[action].back = node;
 
-	wl_tid = mqueue[action].wl_tid;
-	mqueue[action].wl_tid = 0;
-
-	mutex_free(&mqueue[action].mutex);
-
-	if (wl_tid) {
-		wake(wl_tid - 1);
+	q = &mqueue[action];
+	bucket = &q->bucket[mqueue_hash(msg->source)];
+
+	node->msg   = msg;
+	node->next  = NULL;
+	node->bnext = NULL;
+
+	mutex_spin(&q->mutex);
+
+	node->prev = q->back;
+	if (!q->front) q->front = node;
+	if (q->back)   q->back->next = node;
+	q->back = node;
+
+	node->bprev = bucket->back;
+	if (!bucket->front) bucket->front = node;
+	if (bucket->back)   bucket->back->bnext = node;
+	bucket->back = node;
+
+	q->depth++;
+	q->total++;
+	if (q->depth > q->peak) q->peak = q->depth;
+
+	/*
+	 * detach interested waiters and flag them, all under the lock: a waiter
+	 * lives on its thread's stack and may be gone as soon as the lock is
+	 * released. Losers of the race list themselves again.
+	 */
+	prev = &q->waiter;
+	for (waiter = q->waiter; waiter; waiter = *prev) {
+		if (!waiter->source || waiter->source == msg->source) {
+			*prev = waiter->next;
+			waiter->woken = true;
+		}
+		else {
+			prev = &waiter->next;
+		}
 	}
 
+	mutex_free(&q->mutex);
+
 	return 0;
 }
 
@@ -115,35 +293,17 @@ int mqueue_push(struct msg *msg) {
 struct msg *mqueue_pull(uint8_t action, uint64_t source) {
 	struct mqueue_msg *node;
 	struct msg *msg;
-	
+
 	mutex_spin(&mqueue[action].mutex);
+	node = mqueue_find(&mqueue[action], source);
+	mutex_free(&mqueue[action].mutex);
 
-	if (source) {
-		for (node = mqueue[action].front; node; node = node->next) {
-			if (node->msg->source == source) {
-				break;
-			}
-		}
-	}
-	else {
-		node = mqueue[action].front;
-	}
-	
 	if (!node) {
-		mutex_free(&mqueue[action].mutex);
 		return NULL;
 	}
 
-	if (node->prev) node->prev->next = node->next;
-	else mqueue[action].front = node->next;
-
-	if (node->next) node->next->prev = node->prev;
-	else mqueue[action].back = node->prev;
-
-	mutex_free(&mqueue[action].mutex);
-
 	msg = node->msg;
-	free(node);
+	mqueue_node_free(node);
 	return msg;
 }
 
@@ -152,31 +312,82 @@ struct msg *mqueue_pull(uint8_t action, uint64_t source) {
  *
  * Find the first message in the message queue with action <action> and source
  * <source. If <source> is zero, any source matches. If there is no match,
- * this function blocks until a match is found by mqueue_push(). Returns the
- * found message on success, waits forever on failure.
+ * this function blocks until a match is found by mqueue_push(). Any number of
+ * threads may wait on the same action at once. Returns the found message on 
+ * success, waits forever on failure.
  */
 
 struct msg *mqueue_wait(uint8_t action, uint64_t source) {
+	struct mqueue_waiter waiter;
+	struct mqueue_msg *node;
+	struct mqueue *q;
 	struct msg *msg;
 
-	msg = mqueue_pull(action, source);
+	q = &mqueue[action];
 
-	while (!msg) {
-		
-		mutex_spin(&mqueue[action].mutex);
-		if (mqueue[action].wl_tid) {
-			mutex_free(&mqueue[action].mutex);
-			sleep();
-			msg = mqueue_pull(action, source);
-			continue;
+	while (1) {
+		mutex_spin(&q->mutex);
+
+		node = mqueue_find(q, source);
+
+		if (node) {
+			mutex_free(&q->mutex);
+			break;
 		}
-		mqueue[action].wl_tid = gettid() + 1;
-		mutex_free(&mqueue[action].mutex);
 
-		stop();
+		/* list ourselves atomically with the failed search */
+		waiter.source = source;
+		waiter.woken  = false;
+		waiter.next   = q->waiter;
+		q->waiter     = &waiter;
 
-		msg = mqueue_pull(action, source);
+		mutex_free(&q->mutex);
+
+		/*
+		 * mqueue_push unlinks us before setting the flag, so we are off the
+		 * list once it is set. The kernel drops a wake that arrives before 
+		 * the matching stop, so yield until flagged instead of stopping.
+		 */
+		while (!waiter.woken) {
+			sleep();
+		}
 	}
 
+	msg = node->msg;
+	mqueue_node_free(node);
 	return msg;
 }
+
+/*****************************************************************************
+ * mqueue_stat
+ *
+ * Fill <stat> with the queue depth counters of action <action>: the number
+ * of messages currently queued, the highest number ever queued at once, and
+ * the total number of messages ever queued. Returns zero on success, nonzero
+ * on error.
+ */
+
+int mqueue_stat(uint8_t action, struct mqueue_stat *stat) {
+	
+	if (!stat) {
+		return 1;
+	}
+
+	mutex_spin(&mqueue[action].mutex);
+	stat->depth = mqueue[action].depth;
+	stat->peak  = mqueue[action].peak;
+	stat->total = mqueue[action].total;
+	mutex_free(&mqueue[action].mutex);
+
+	return 0;
+}
+
+/*****************************************************************************
+ * mqueue_depth
+ *
+ * Returns the number of messages currently queued for action <action>.
+ */
+
+uint32_t mqueue_depth(uint8_t action) {
+	return mqueue[action].depth;
+}
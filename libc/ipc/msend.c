@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009-2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2009-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -27,6 +27,7 @@ int msend(struct msg *msg) {
 	uint8_t  action;
 	uint32_t count;
 	uint32_t target_pid;
+	size_t size;
 	int err;
 
 	/* check message and alignment */
@@ -48,7 +49,24 @@ int msend(struct msg *msg) {
 	count = (count % PAGESZ) ? (count / PAGESZ) + 1 : count / PAGESZ;
 
 	err = _send((uintptr_t) msg, count, action, target_pid);
-	free(msg);
+
+	if (err) {
+		free(msg);
+		return err;
+	}
+
+	/* 
+	 * On success, the sent pages are no longer mapped. Any pages past them
+	 * (e.g. when a reply is shortened after its payload was shared) may
+	 * still share frames with something else, so they must be unmapped too
+	 * before the run can be reused.
+	 */
+	size = msize(msg);
+	if (size > count * PAGESZ) {
+		page_free((uint8_t*) msg + count * PAGESZ, size - count * PAGESZ);
+	}
+
+	free_unmapped(msg);
 
 	return err;
 }
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2012 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * 
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <stdint.h>
+
+#include <rho/mutex.h>
+#include <rho/proc.h>
+
+/****************************************************************************
+ * RWLOCK_SPIN
+ *
+ * Number of attempts made on a contended reader/writer lock before giving
+ * up the rest of the timeslice. There is no kernel wait queue to block on,
+ * so a waiter spins briefly (the holder is often running on another CPU or
+ * about to be) and then yields to let the holder run.
+ */
+
+#define RWLOCK_SPIN 64
+
+/****************************************************************************
+ * rwlock_rspin
+ *
+ * Acquires <lock> for reading, waiting as long as a writer holds the lock
+ * or is waiting for it.
+ */
+
+void rwlock_rspin(uint32_t *lock) {
+	int i;
+
+	while (1) {
+		for (i = 0; i < RWLOCK_SPIN; i++) {
+			if (rwlock_rtry(lock)) return;
+		}
+
+		sleep();
+	}
+}
+
+/****************************************************************************
+ * rwlock_wspin
+ *
+ * Acquires <lock> for writing. While waiting, the lock is flagged so that no
+ * new readers get in ahead of the writer.
+ */
+
+void rwlock_wspin(uint32_t *lock) {
+	int i;
+
+	while (1) {
+		for (i = 0; i < RWLOCK_SPIN; i++) {
+			if (rwlock_wtry(lock)) return;
+			__rwlock_wflag(lock);
+		}
+
+		sleep();
+	}
+}
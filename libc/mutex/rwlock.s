@@ -0,0 +1,89 @@
+; Copyright (C) 2012 Nick Johnson <nickbjohnson4224 at gmail.com>
+; 
+; Permission to use, copy, modify, and distribute this software for any
+; purpose with or without fee is hereby granted, provided that the above
+; copyright notice and this permission notice appear in all copies.
+; 
+; THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+; WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+; MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+; ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+; WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+; ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+; OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+
+[bits 32]
+
+section .text
+
+; A reader/writer lock is a 32-bit word: bit 31 is set while a writer holds
+; the lock, bit 30 while a writer is waiting for it, and the low bits count
+; readers. New readers are turned away while either high bit is set.
+
+%define RW_WRITER 0x80000000
+%define RW_WAITER 0x40000000
+
+global rwlock_rtry:function rwlock_rtry.end-rwlock_rtry
+
+rwlock_rtry:
+	mov edx, [esp+4]
+	mov eax, [edx]
+
+.retry:
+	test eax, RW_WRITER | RW_WAITER
+	jnz .fail
+	lea ecx, [eax+1]
+	lock cmpxchg [edx], ecx
+	jnz .retry
+
+	mov eax, 1
+	ret
+.fail:
+	xor eax, eax
+	ret
+.end:
+
+global rwlock_rfree:function rwlock_rfree.end-rwlock_rfree
+
+rwlock_rfree:
+	mov edx, [esp+4]
+	lock dec dword [edx]
+	ret
+.end:
+
+global rwlock_wtry:function rwlock_wtry.end-rwlock_wtry
+
+rwlock_wtry:
+	mov edx, [esp+4]
+	mov eax, [edx]
+
+.retry:
+	test eax, ~RW_WAITER
+	jnz .fail
+	mov ecx, RW_WRITER
+	lock cmpxchg [edx], ecx
+	jnz .retry
+
+	mov eax, 1
+	ret
+.fail:
+	xor eax, eax
+	ret
+.end:
+
+global __rwlock_wflag:function __rwlock_wflag.end-__rwlock_wflag
+
+__rwlock_wflag:
+	mov edx, [esp+4]
+	lock or dword [edx], RW_WAITER
+	ret
+.end:
+
+global rwlock_wfree:function rwlock_wfree.end-rwlock_wfree
+
+rwlock_wfree:
+	mov edx, [esp+4]
+	mov dword [edx], 0
+	ret
+.end:
@@ -0,0 +1,335 @@
+/*
+ * Copyright (C) 2012 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * 
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <rhombus.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include <rho/mutex.h>
+#include <rho/natio.h>
+
+/*****************************************************************************
+ * path resolution cache
+ *
+ * Remembers the answers of "find" rcalls per process, keyed by the root 
+ * resource pointer and the simplified path that was looked up. Besides 
+ * ordinary results, two kinds of entries also apply to every path below 
+ * their own:
+ *
+ *   - symbolic links (mountpoints like /dev or /tmp), learned from the 
+ *     ">> link/tail" redirect a driver returns when its walk hits a link;
+ *   - negative entries, for paths that were not found.
+ *
+ * Once a mountpoint has been seen, any path through it is redirected
+ * locally, and only the driver on the other side is asked (if at all).
+ *
+ * Each entry only depends on the driver that produced it, so a "changed
+ * <rp> dir" event from a driver drops exactly the entries rooted in that
+ * driver. Drivers built on librdi send such events to every process whose
+ * lookups have passed through the changed directory.
+ */
+
+#define DCACHE_BUCKETS 256
+#define DCACHE_MAX     1024
+
+#define DCACHE_FOUND   0	/* path resolves to rp */
+#define DCACHE_FOUNDL  1	/* path resolves to rp with -L only */
+#define DCACHE_NOENT   2	/* path (and everything below it) does not exist */
+#define DCACHE_LINK    3	/* path is a symbolic link to <link> */
+
+/* kinds of entries that answer a lookup of a path below, at, or at with -L */
+#define DCACHE_PREFIX  ((1 << DCACHE_NOENT) | (1 << DCACHE_LINK))
+#define DCACHE_EXACT   ((1 << DCACHE_FOUND) | (1 << DCACHE_NOENT) | (1 << DCACHE_LINK))
+#define DCACHE_EXACTL  ((1 << DCACHE_FOUND) | (1 << DCACHE_NOENT) | (1 << DCACHE_FOUNDL))
+
+struct dcache_entry {
+	struct dcache_entry *next;
+	uint32_t hash;
+	uint32_t kind;
+	rp_t   root;
+	rp_t   rp;
+	size_t length;
+	char  *path;
+	char  *link;
+};
+
+static struct dcache_entry *_dcache[DCACHE_BUCKETS];
+static uint32_t _dcache_lock;
+static uint32_t _dcache_gen;
+static size_t   _dcache_count;
+
+static uint32_t _hash_step(uint32_t hash, char c) {
+	return (hash ^ (uint8_t) c) * 16777619;
+}
+
+static uint32_t _hash_root(rp_t root) {
+	return (2166136261U ^ RP_PID(root)) * 16777619 + RP_INDEX(root);
+}
+
+static void _free_entry(struct dcache_entry *entry) {
+	free(entry->path);
+	free(entry->link);
+	free(entry);
+}
+
+static char *_strndup(const char *s, size_t length) {
+	char *copy;
+
+	copy = malloc(length + 1);
+	if (!copy) return NULL;
+
+	memcpy(copy, s, length);
+	copy[length] = '\0';
+
+	return copy;
+}
+
+/*
+ * Finds an entry of one of the kinds in the bitmask <kinds> for the first 
+ * <length> characters of <path> under <root>. The cache must be locked.
+ */
+
+static struct dcache_entry *_lookup(rp_t root, const char *path, size_t length, uint32_t hash, uint32_t kinds) {
+	struct dcache_entry *entry;
+
+	for (entry = _dcache[hash % DCACHE_BUCKETS]; entry; entry = entry->next) {
+		if (entry->hash == hash && entry->root == root && entry->length == length
+				&& (kinds & (1 << entry->kind)) && !memcmp(entry->path, path, length)) {
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Drops all entries rooted in process <pid>, or every entry if <pid> is 0.
+ * The cache must be write locked.
+ */
+
+static void _drop(uint32_t pid) {
+	struct dcache_entry **prev, *entry;
+	int i;
+
+	for (i = 0; i < DCACHE_BUCKETS; i++) {
+		prev = &_dcache[i];
+
+		while ((entry = *prev)) {
+			if (!pid || RP_PID(entry->root) == pid) {
+				*prev = entry->next;
+				_free_entry(entry);
+				_dcache_count--;
+			}
+			else {
+				prev = &entry->next;
+			}
+		}
+	}
+}
+
+/*****************************************************************************
+ * dcache_get
+ *
+ * Returns the reply that a "find" (or "find -L" if <link> is set) rcall for
+ * the simplified path <path> to <root> would give, if it can be derived from
+ * the cache, or NULL if it cannot.
+ */
+
+char *dcache_get(rp_t root, const char *path, int link) {
+	struct dcache_entry *entry;
+	uint32_t hash;
+	size_t i;
+	char *reply;
+
+	if (!_dcache_count) {
+		return NULL;
+	}
+
+	reply = NULL;
+	hash  = _hash_root(root);
+
+	rwlock_rspin(&_dcache_lock);
+
+	// check each proper prefix for mountpoints and negative entries
+	for (i = 0; path[i]; i++) {
+		if (path[i] == '/') {
+			entry = _lookup(root, path, i, hash, DCACHE_PREFIX);
+
+			if (entry && entry->kind == DCACHE_LINK) {
+				reply = saprintf(">> %s/%s", entry->link, &path[i]);
+				break;
+			}
+			if (entry && entry->kind == DCACHE_NOENT) {
+				reply = errorstr(ENOENT);
+				break;
+			}
+		}
+
+		hash = _hash_step(hash, path[i]);
+	}
+
+	// check the path itself
+	if (!reply) {
+		entry = _lookup(root, path, i, hash, (link) ? DCACHE_EXACTL : DCACHE_EXACT);
+
+		if (entry && entry->kind == DCACHE_LINK) {
+			reply = saprintf(">> %s/", entry->link);
+		}
+		else if (entry && entry->kind == DCACHE_NOENT) {
+			reply = errorstr(ENOENT);
+		}
+		else if (entry) {
+			reply = rtoa(entry->rp);
+		}
+	}
+
+	rwlock_rfree(&_dcache_lock);
+
+	return reply;
+}
+
+/*****************************************************************************
+ * dcache_put
+ *
+ * Remembers <reply>, the result of a "find" (or "find -L" if <link> is set)
+ * rcall for the simplified path <path> to <root>. <gen> must be the value 
+ * dcache_gen() returned before the rcall was sent; if the cache has been
+ * invalidated since then, <reply> may be stale and is not stored.
+ */
+
+void dcache_put(rp_t root, const char *path, int link, const char *reply, uint32_t gen) {
+	struct dcache_entry *entry;
+	size_t length, rlength, tlength, i;
+	const char *tail;
+
+	if (!reply) {
+		return;
+	}
+
+	entry = calloc(sizeof(struct dcache_entry), 1);
+	if (!entry) return;
+
+	length = strlen(path);
+
+	if (reply[0] == '>' && reply[1] == '>' && reply[2] == ' ') {
+		// the reply is "<link>/<tail>", where <tail> is either empty or 
+		// the part of <path> below the link; when several splits fit,
+		// the longest link path is always a correct one
+		reply += 3;
+		rlength = strlen(reply);
+		tail = NULL;
+
+		if (rlength && reply[rlength - 1] == '/') {
+			tail = &path[length];
+		}
+		else for (i = length; i-- > 0;) {
+			if (path[i] != '/') continue;
+
+			tlength = length - i;
+			if (rlength > tlength && reply[rlength - tlength - 1] == '/'
+					&& !strcmp(&reply[rlength - tlength], &path[i])) {
+				tail = &path[i];
+				break;
+			}
+		}
+
+		if (!tail) {
+			free(entry);
+			return;
+		}
+
+		tlength = strlen(tail);
+		entry->kind = DCACHE_LINK;
+		entry->link = _strndup(reply, rlength - tlength - 1);
+		length -= tlength;
+	}
+	else if (iserror(reply)) {
+		if (geterror(reply) != ENOENT) {
+			free(entry);
+			return;
+		}
+		entry->kind = DCACHE_NOENT;
+	}
+	else {
+		entry->kind = (link) ? DCACHE_FOUNDL : DCACHE_FOUND;
+		entry->rp = ator(reply);
+	}
+
+	entry->root   = root;
+	entry->length = length;
+	entry->path   = _strndup(path, length);
+	entry->hash   = _hash_root(root);
+	for (i = 0; i < length; i++) {
+		entry->hash = _hash_step(entry->hash, path[i]);
+	}
+
+	if (!entry->path || (entry->kind == DCACHE_LINK && !entry->link)) {
+		_free_entry(entry);
+		return;
+	}
+
+	__rcache_hook();
+
+	rwlock_wspin(&_dcache_lock);
+
+	if (gen != _dcache_gen || _lookup(root, entry->path, length, entry->hash, 1 << entry->kind)) {
+		rwlock_wfree(&_dcache_lock);
+		_free_entry(entry);
+		return;
+	}
+
+	if (_dcache_count >= DCACHE_MAX) {
+		_drop(0);
+	}
+
+	entry->next = _dcache[entry->hash % DCACHE_BUCKETS];
+	_dcache[entry->hash % DCACHE_BUCKETS] = entry;
+	_dcache_count++;
+
+	rwlock_wfree(&_dcache_lock);
+}
+
+/*****************************************************************************
+ * dcache_gen
+ *
+ * Returns the current generation of the path resolution cache, which is
+ * advanced every time it is invalidated.
+ */
+
+uint32_t dcache_gen(void) {
+	return _dcache_gen;
+}
+
+/*****************************************************************************
+ * dcache_flush
+ *
+ * Drops all cached path lookups answered by process <pid>, or the whole
+ * cache if <pid> is 0.
+ */
+
+void dcache_flush(uint32_t pid) {
+
+	rwlock_wspin(&_dcache_lock);
+	_dcache_gen++;
+	if (_dcache_count) {
+		_drop(pid);
+	}
+	rwlock_wfree(&_dcache_lock);
+}
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009-2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2009-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -28,6 +28,8 @@
  *
  * Finds the robject with the given path <path> if it exists and returns a
  * robject pointer to it. If it does not exist, this function returns RP_NULL.
+ * Lookups are answered from the path resolution cache when possible, and
+ * otherwise ask the root driver to follow links to other drivers itself.
  */
 
 static rp_t __fs_find(const char *path, int linkmax, int link);
@@ -45,6 +47,8 @@ static rp_t __fs_find(const char *path, int linkmax, int link) {
 	uint64_t root;
 	char *reply;
 	char *path_s;
+	char *last;
+	uint32_t gen;
 
 	// if too many links have been followed, fail
 	if (linkmax < 0) {
@@ -78,11 +82,32 @@ static rp_t __fs_find(const char *path, int linkmax, int link) {
 	path_s = path_simplify(path);
 	if (!path_s) return RP_NULL;
 
-	if (link) {
-		reply = rcall(root, 0, "find -L %s", path_s);
-	}
-	else {
-		reply = rcall(root, 0, "find %s", path_s);
+	reply = dcache_get(root, path_s, link);
+
+	if (!reply) {
+		gen = dcache_gen();
+
+		if (link) {
+			reply = rcall(root, 0, "find -r -L %s", path_s);
+		}
+		else {
+			reply = rcall(root, 0, "find -r %s", path_s);
+		}
+
+		// the first line is the root's own answer; if it was a redirect, the
+		// root may have followed it for us, and each further line is the 
+		// answer of the next driver along the way
+		last = (reply) ? strchr(reply, '\n') : NULL;
+		if (last) *last++ = '\0';
+
+		dcache_put(root, path_s, link, reply, gen);
+
+		if (last) {
+			for (linkmax--; strchr(last, '\n'); linkmax--) {
+				last = strchr(last, '\n') + 1;
+			}
+			memmove(reply, last, strlen(last) + 1);
+		}
 	}
 
 	free(path_s);
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2011-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -126,7 +126,11 @@ void *rp_mmap(rp_t rp, rk_t key, void *addr, size_t size, off_t offset, int prot
 
 	// map recieved pages to <addr>
 	page_self(&msg->data[PAGESZ - sizeof(struct msg)], addr, size);
-	
-	free(msg);
+
+	// the message still shares frames with <addr>; unmap it so its run is
+	// not reused while aliasing the mapping
+	page_free(msg, msize(msg));
+	free_unmapped(msg);
+
 	return addr;
 }
@@ -42,6 +42,9 @@ int rp_reset(uint64_t file, rk_t key) {
 	if (msend(msg)) return 1;
 	msg = mwait(ACTION_REPLY, file);
 
+	// our own change may have made a cached size stale
+	rcache_flush(file);
+
 	free(msg);
 	return 0;
 }	
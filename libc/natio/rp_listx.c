@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2012 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * 
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include <rho/natio.h>
+
+/*****************************************************************************
+ * rp_listx
+ *
+ * List the contents of the directory <dir> along with each entry's resource
+ * pointer, type and size, using the "listx" rcall, which costs one round 
+ * trip per page of entries rather than one per entry. On success, an array 
+ * of entries in name order, terminated by one with a NULL name, is 
+ * returned, and the number of entries is stored in <count> if it is not 
+ * NULL; the array and its strings are a single allocation, freed with 
+ * free(). On failure, NULL is
+ * returned and errno is set; ENOSYS means the directory's driver does not 
+ * support listx, and rp_list should be used instead.
+ */
+
+struct rp_dirent *rp_listx(rp_t dir, size_t *count) {
+	struct rp_dirent *entry;
+	uint32_t size0, size1;
+	size_t length, total, n, i;
+	char *text, *temp, *reply, *body, *pos, *cursor, *field[4];
+
+	text  = NULL;
+	total = 0;
+	cursor = NULL;
+
+	// collect every page into one buffer
+	do {
+		if (cursor) {
+			reply = rcall(dir, 0, "listx %s", cursor);
+			free(cursor);
+			cursor = NULL;
+		}
+		else {
+			reply = rcall(dir, 0, "listx");
+		}
+
+		if (!reply) {
+			errno = ENOSYS;
+			free(text);
+			return NULL;
+		}
+
+		if (iserror(reply)) {
+			errno = geterror(reply);
+			free(reply);
+			free(text);
+			return NULL;
+		}
+
+		// the first line is the cursor for the next page, if any
+		length = strcspn(reply, "\n");
+		body = &reply[length];
+		if (*body == '\n') body++;
+
+		if (length) {
+			cursor = malloc(length + 1);
+			if (!cursor) {
+				free(reply);
+				free(text);
+				return NULL;
+			}
+
+			memcpy(cursor, reply, length);
+			cursor[length] = '\0';
+		}
+
+		length = strlen(body);
+		temp = realloc(text, total + length + 1);
+		if (!temp) {
+			free(cursor);
+			free(reply);
+			free(text);
+			return NULL;
+		}
+
+		text = temp;
+		memcpy(&text[total], body, length + 1);
+		total += length;
+		free(reply);
+	} while (cursor);
+
+	for (n = 0, i = 0; i < total; i++) {
+		if (text[i] == '\n') n++;
+	}
+
+	// the entry array is followed by the text its strings point into
+	entry = malloc(sizeof(struct rp_dirent) * (n + 1) + total + 1);
+	if (!entry) {
+		free(text);
+		return NULL;
+	}
+
+	pos = (char*) &entry[n + 1];
+	memcpy(pos, text, total + 1);
+	free(text);
+
+	for (i = 0; i < n; i++) {
+
+		// split "name\trp\ttype\tsize\n" in place
+		for (length = 0; length < 4; length++) {
+			field[length] = pos;
+			pos += strcspn(pos, (length < 3) ? "\t\n" : "\n");
+			if (*pos) *pos++ = '\0';
+		}
+
+		size0 = size1 = 0;
+		sscanf(field[3], "%u:%u", &size0, &size1);
+
+		entry[i].name = field[0];
+		entry[i].rp   = ator(field[1]);
+		entry[i].type = field[2];
+		entry[i].size = size1 | (uint64_t) size0 << 32;
+	}
+
+	entry[n].name = NULL;
+	entry[n].type = NULL;
+	entry[n].rp   = 0;
+	entry[n].size = 0;
+
+	if (count) *count = n;
+
+	return entry;
+}
@@ -38,7 +38,7 @@ off_t rp_size(rp_t file) {
 		return 0;
 	}
 
-	reply = rcall(file, 0, "size");
+	reply = rcall_cached(file, 0, "size");
 
 	if (!reply) {
 		errno = ENOSYS;
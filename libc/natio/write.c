@@ -56,6 +56,9 @@ size_t rp_write(uint64_t file, rk_t key, void *buf, size_t size, uint64_t offset
 	if (msend(msg)) return 0;
 	msg = mwait(ACTION_REPLY, file);
 
+	// our own change may have made a cached size stale
+	rcache_flush(file);
+
 	if (msg->length != sizeof(uint32_t)) {
 		size = 0;
 	}
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2011-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -17,6 +17,7 @@
 #include <rhombus.h>
 #include <stdint.h>
 
+#include <rho/natio.h>
 #include <rho/proc.h>
 #include <rho/abi.h>
 
@@ -28,5 +29,11 @@ int fork(void) {
 
 	resetpid();
 
+	if (pid == 0) {
+		// drivers only know to tell the parent when cached results change
+		dcache_flush(0);
+		rcache_flush(RP_NULL);
+	}
+
 	return pid;
 }
@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2012 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * 
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+
+#include <rho/natio.h>
+#include <rho/proc.h>
+#include <rho/ipc.h>
+
+/*****************************************************************************
+ * Binary rcall wire format
+ *
+ * The request payload begins with a fixed header holding the method ID and
+ * the signature, followed by the packed arguments in order: 'i' arguments
+ * take four bytes, 'r' arguments eight, and 'b' arguments a four byte size
+ * followed by the blob contents, padded to a multiple of four bytes. The
+ * reply payload is a single int32_t.
+ */
+
+struct brcall_head {
+	uint32_t method;
+	uint32_t argc;
+	char     sig[BRCALL_MAXARG];
+} __attribute__((packed));
+
+#define BRCALL_ALIGN(n) (((n) + 3) & ~3)
+
+/*****************************************************************************
+ * __brcall
+ *
+ * Pack the arguments described by <sig> from <ap> directly into a message
+ * payload, send it to <rp>, and wait for the integer reply.
+ */
+
+static int __brcall(rp_t rp, rk_t key, uint32_t method, const char *sig, va_list ap) {
+	struct brcall_head *head;
+	struct msg *msg;
+	const void *blob;
+	uint32_t size;
+	size_t length;
+	uint8_t *data;
+	va_list ap1;
+	int32_t ret;
+	int i, argc;
+
+	argc = strlen(sig);
+	if (argc > BRCALL_MAXARG) {
+		return -EINVAL;
+	}
+
+	/* measure payload */
+	length = sizeof(struct brcall_head);
+	va_copy(ap1, ap);
+	for (i = 0; i < argc; i++) {
+		switch (sig[i]) {
+		case 'i': 
+			va_arg(ap1, int); 
+			length += sizeof(int32_t); 
+			break;
+		case 'r': 
+			va_arg(ap1, rp_t); 
+			length += sizeof(uint64_t); 
+			break;
+		case 'b': 
+			va_arg(ap1, const void*);
+			length += sizeof(uint32_t) + BRCALL_ALIGN(va_arg(ap1, size_t));
+			break;
+		default:
+			va_end(ap1);
+			return -EINVAL;
+		}
+	}
+	va_end(ap1);
+
+	msg = aalloc(sizeof(struct msg) + length, PAGESZ);
+	if (!msg) return -ENOMEM;
+	msg->source = RP_CURRENT_THREAD;
+	msg->target = rp;
+	msg->key    = key;
+	msg->length = length;
+	msg->action = ACTION_BRCALL;
+	msg->arch   = ARCH_NAT;
+
+	/* pack arguments */
+	head = (struct brcall_head*) msg->data;
+	head->method = method;
+	head->argc   = argc;
+	memset(head->sig, 0, BRCALL_MAXARG);
+	memcpy(head->sig, sig, argc);
+
+	data = &msg->data[sizeof(struct brcall_head)];
+	for (i = 0; i < argc; i++) {
+		switch (sig[i]) {
+		case 'i':
+			*(int32_t*) data = va_arg(ap, int);
+			data += sizeof(int32_t);
+			break;
+		case 'r':
+			*(uint64_t*) data = va_arg(ap, rp_t);
+			data += sizeof(uint64_t);
+			break;
+		case 'b':
+			blob = va_arg(ap, const void*);
+			size = va_arg(ap, size_t);
+			*(uint32_t*) data = size;
+			memcpy(&data[sizeof(uint32_t)], blob, size);
+			data += sizeof(uint32_t) + BRCALL_ALIGN(size);
+			break;
+		}
+	}
+
+	if (msend(msg)) return -EIO;
+	msg = mwait(ACTION_REPLY, rp);
+
+	if (msg->length >= sizeof(int32_t)) {
+		ret = *(int32_t*) msg->data;
+	}
+	else {
+		ret = -ENOSYS;
+	}
+
+	free(msg);
+	return ret;
+}
+
+/*****************************************************************************
+ * brcall
+ *
+ * Binary remote procedure call. Calls method <method> of the resource <rp>
+ * with the arguments described by the signature <sig>. Returns the integer
+ * result of the method, or a negated errno code on error.
+ */
+
+int brcall(rp_t rp, rk_t key, uint32_t method, const char *sig, ...) {
+	va_list ap;
+	int ret;
+
+	va_start(ap, sig);
+	ret = __brcall(rp, key, method, sig, ap);
+	va_end(ap);
+
+	return ret;
+}
+
+int fbrcall(int fd, int aclass, uint32_t method, const char *sig, ...) {
+	va_list ap;
+	int ret;
+
+	va_start(ap, sig);
+	ret = __brcall(fd_rp(fd), fd_getkey(fd, aclass), method, sig, ap);
+	va_end(ap);
+
+	return ret;
+}
+
+/*****************************************************************************
+ * brcall_unpack
+ *
+ * Unpack a binary rcall request message into its method ID <method>, its
+ * signature <sig> (which must have room for BRCALL_MAXARG + 1 characters),
+ * and its arguments <argv> (which must have room for BRCALL_MAXARG entries).
+ * Blob arguments point into the message itself, so no memory is allocated.
+ * Returns the argument count on success, -1 if the message is malformed.
+ */
+
+int brcall_unpack(struct msg *msg, uint32_t *method, char *sig, struct brcall_arg *argv) {
+	struct brcall_head *head;
+	uint8_t *data, *end;
+	uint32_t i, argc;
+
+	if (msg->length < sizeof(struct brcall_head)) {
+		return -1;
+	}
+
+	head = (struct brcall_head*) msg->data;
+	argc = head->argc;
+
+	if (argc > BRCALL_MAXARG) {
+		return -1;
+	}
+
+	data = &msg->data[sizeof(struct brcall_head)];
+	end  = &msg->data[msg->length];
+
+	for (i = 0; i < argc; i++) {
+		argv[i].type = head->sig[i];
+
+		switch (head->sig[i]) {
+		case 'i':
+			if (data + sizeof(int32_t) > end) return -1;
+			argv[i].i = *(int32_t*) data;
+			data += sizeof(int32_t);
+			break;
+		case 'r':
+			if (data + sizeof(uint64_t) > end) return -1;
+			argv[i].rp = *(uint64_t*) data;
+			data += sizeof(uint64_t);
+			break;
+		case 'b':
+			if (data + sizeof(uint32_t) > end) return -1;
+			argv[i].size = *(uint32_t*) data;
+			argv[i].blob = &data[sizeof(uint32_t)];
+			if (argv[i].size > (uint32_t) (end - data) - sizeof(uint32_t)) return -1;
+			data += sizeof(uint32_t) + BRCALL_ALIGN(argv[i].size);
+			break;
+		default:
+			return -1;
+		}
+
+		sig[i] = head->sig[i];
+	}
+
+	sig[argc] = '\0';
+	*method = head->method;
+
+	return argc;
+}
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2011-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -43,5 +43,5 @@ int close(int fd) {
 	}
 
 	// clear file descriptor entry
-	return fd_set(fd, rp, 0);
+	return fd_free(fd);
 }
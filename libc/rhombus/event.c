@@ -47,12 +47,12 @@ int fevent(int fd, const char *value) {
 	return event(fd_rp(fd), value);
 }
 
-static void __event_handler(struct msg *msg) {
+static void __event_dispatch(rp_t source, const char *value) {
 	event_t hook;
 	char **argv;
 	int argc;
 
-	argv = strparse((const char*) msg->data, " ");
+	argv = strparse(value, " ");
 	if (!argv) return;
 
 	for (argc = 0; argv[argc]; argc++);
@@ -60,11 +60,34 @@ static void __event_handler(struct msg *msg) {
 	hook = (event_t) (uintptr_t) s_table_get(event_table, argv[0]);
 
 	if (hook) {
-		hook(msg->source, argc, argv);
+		hook(source, argc, argv);
 	}
 
 	for (argc = 0; argv[argc]; argc++) free(argv[argc]);
 	free(argv);
+}
+
+/*****************************************************************************
+ * __event_handler
+ *
+ * A single event message may carry a batch of several NUL-terminated event
+ * strings; each is dispatched in order.
+ */
+
+static void __event_handler(struct msg *msg) {
+	const char *value;
+	uint32_t offset;
+
+	for (offset = 0; offset < msg->length; offset += strlen(value) + 1) {
+		value = (const char*) &msg->data[offset];
+
+		if (!memchr(value, '\0', msg->length - offset)) {
+			// unterminated event string
+			break;
+		}
+
+		__event_dispatch(msg->source, value);
+	}
 
 	free(msg);
 }
@@ -14,181 +14,267 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+
 #include <rhombus.h>
 #include <stdlib.h>
 #include <rho/mutex.h>
+#include <rho/proc.h>
 	
 /*****************************************************************************
  * File Descriptor Table
+ *
+ * The table is an array of fixed-size chunks that are allocated on demand
+ * and never moved or freed, so looking up a descriptor takes no lock. The
+ * mutex only serializes allocation: a bitmap of used descriptors (with a 
+ * second-level bitmap of full words) finds the smallest free descriptor in
+ * constant time. Descriptors 0 through 3 are never handed out by fd_alloc.
+ *
+ * fdtab_gen is advanced whenever any descriptor is changed, so callers 
+ * (like stdio streams) may cache fd_rp() and fd_getkey() until it moves.
+ * It is also a sequence lock: writers hold the mutex and keep it odd while
+ * they change an entry, and the lock-free readers of 64-bit fields retry 
+ * until they see the same even value before and after, so they never 
+ * return half of an old pointer or key and half of a new one.
  */
 
+#define FDTAB_MAX	4096
+#define FDTAB_CHUNK	64
+
 struct fdtab {
 	int mode;		// file connection status
-	rp_t rp;		// file resource pointer
-	rk_t key[8];	// file action keys
+	volatile rp_t rp;		// file resource pointer
+	volatile rk_t key[8];	// file action keys
 	uint64_t pos;	// file position
 };
 
-static struct fdtab *_fdtab = NULL;
-static bool  _fdtab_mutex   = false;
-static int   _fdtab_size    = 0;
+static struct fdtab *volatile _fdtab[FDTAB_MAX / FDTAB_CHUNK];
+static uint32_t _fdtab_used[FDTAB_MAX / 32] = { 0xF };
+static uint32_t _fdtab_full[FDTAB_MAX / 1024];
+static bool     _fdtab_mutex = false;
+
+volatile uint32_t fdtab_gen;
+
+static uint32_t _read_begin(void) {
+	uint32_t gen;
+
+	while ((gen = fdtab_gen) & 1) {
+		sleep();
+	}
+
+	return gen;
+}
+
+static struct fdtab *_fd(int fd) {
+	struct fdtab *chunk;
+
+	if (fd < 0 || fd >= FDTAB_MAX) {
+		// file descriptor out of range
+		return NULL;
+	}
+
+	chunk = _fdtab[fd / FDTAB_CHUNK];
+
+	return (chunk) ? &chunk[fd % FDTAB_CHUNK] : NULL;
+}
+
+// the following must be called with the mutex held
+
+static void _mark(int fd) {
+	_fdtab_used[fd / 32] |= 1U << (fd % 32);
+
+	if (_fdtab_used[fd / 32] == 0xFFFFFFFF) {
+		_fdtab_full[fd / 1024] |= 1U << (fd / 32 % 32);
+	}
+}
+
+static void _unmark(int fd) {
+	
+	if (fd >= 4) {
+		_fdtab_used[fd / 32]   &= ~(1U << (fd % 32));
+		_fdtab_full[fd / 1024] &= ~(1U << (fd / 32 % 32));
+	}
+}
 
 int fd_alloc(void) {
-	int i;
+	uint32_t i, word;
+	int fd;
 
 	mutex_spin(&_fdtab_mutex);
 
-	// find the smallest open file descriptor with index >= 4
-	for (i = 4; i < _fdtab_size; i++) {
-		if (_fdtab[i].rp == RP_NULL) {
-			mutex_free(&_fdtab_mutex);
-			return i;
-		}
+	// find the smallest unused file descriptor (which is >= 4)
+	for (i = 0; i < FDTAB_MAX / 1024; i++) {
+		if (_fdtab_full[i] != 0xFFFFFFFF) break;
 	}
 
-	// if table is not large enough, default to 4
-	i = (_fdtab_size < 4) ? 4 : _fdtab_size;
+	if (i == FDTAB_MAX / 1024) {
+		// table is full
+		mutex_free(&_fdtab_mutex);
+		return -1;
+	}
+
+	word = i * 32 + __builtin_ctz(~_fdtab_full[i]);
+	fd = word * 32 + __builtin_ctz(~_fdtab_used[word]);
+
+	// reserve it until it is set
+	_mark(fd);
 
 	mutex_free(&_fdtab_mutex);
 
-	return i;
+	return fd;
 }
 
 int fd_set(int fd, rp_t rp, int mode) {
-	int i;
+	struct fdtab *chunk;
+	struct fdtab *file;
 
-	if (fd < 0 || fd >= 4096) {
+	if (fd < 0 || fd >= FDTAB_MAX) {
 		// file descriptor out of range
 		return -1;
 	}
 
 	mutex_spin(&_fdtab_mutex);
 
-	if (_fdtab_size <= fd) {
+	if (!_fdtab[fd / FDTAB_CHUNK]) {
 
-		// reallocate table
-		_fdtab_size = fd + 1;
-		_fdtab = realloc(_fdtab, (uint32_t) _fdtab_size * sizeof(struct fdtab));
+		// allocate chunk
+		chunk = calloc(FDTAB_CHUNK, sizeof(struct fdtab));
 
-		// clear remainder of table
-		for (i = fd; i < _fdtab_size; i++) {
-			_fdtab[i].rp = RP_NULL;
+		if (!chunk) {
+			_unmark(fd);
+			mutex_free(&_fdtab_mutex);
+			return -1;
 		}
+
+		_fdtab[fd / FDTAB_CHUNK] = chunk;
 	}
 
 	// set table entry
-	_fdtab[fd].rp = rp;
-	_fdtab[fd].mode = mode;
+	file = _fd(fd);
+	fdtab_gen++;
+	file->rp = rp;
+	file->mode = mode;
+	fdtab_gen++;
+
+	if (rp) {
+		_mark(fd);
+	}
+	else {
+		_unmark(fd);
+	}
 
 	mutex_free(&_fdtab_mutex);
 
 	return 0;
 }
 
+int fd_free(int fd) {
+	return fd_set(fd, RP_NULL, 0);
+}
+
 int fd_genkeys(int fd) {
+	struct fdtab *file;
+	rk_t key[8];
+	rp_t rp;
 
-	if (fd < 0 || fd >= _fdtab_size) {
+	file = _fd(fd);
+
+	if (!file) {
 		// file descriptor out of range
 		return -1;
 	}
 
-	mutex_spin(&_fdtab_mutex);
-
+	// fetch the keys first: rp_getkey is an rcall, too slow to hold the lock
+	rp = fd_rp(fd);
 	for (int i = 0; i < 8; i++) {
-		if (_fdtab[fd].mode & (1 << i)) {
-			_fdtab[fd].key[i] = rp_getkey(_fdtab[fd].rp, i);
+		if (file->mode & (1 << i)) {
+			key[i] = rp_getkey(rp, i);
 		}
 		else {
-			_fdtab[fd].key[i] = 0ULL;
+			key[i] = 0ULL;
 		}
 	}
 
+	mutex_spin(&_fdtab_mutex);
+
+	fdtab_gen++;
+	for (int i = 0; i < 8; i++) {
+		file->key[i] = key[i];
+	}
+	fdtab_gen++;
+
 	mutex_free(&_fdtab_mutex);
 
 	return 0;
 }
 
 rk_t fd_getkey(int fd, int action) {
+	struct fdtab *file;
+	uint32_t gen;
 	rk_t key;
-	
-	if (fd < 0 || fd >= _fdtab_size) {
-		// file descriptor out of range
-		return 0ULL;
-	}
 
 	if (action < 0 || action >= 8) {
 		// action class out of range
 		return 0ULL;
 	}
 
-	key = _fdtab[fd].key[action];
+	file = _fd(fd);
+
+	if (!file) {
+		return 0ULL;
+	}
+
+	do {
+		gen = _read_begin();
+		key = file->key[action];
+	} while (gen != fdtab_gen);
 
 	return key;
 }
 
 int fd_mode(int fd) {
-	int mode;
-	
-	mutex_spin(&_fdtab_mutex);
+	struct fdtab *file;
 
-	if (fd < 0 || _fdtab_size <= fd) {
-		mode = 0;
-	}
-	else {
-		mode = _fdtab[fd].mode;
-	}
-
-	mutex_free(&_fdtab_mutex);
+	file = _fd(fd);
 
-	return mode;
+	return (file) ? file->mode : 0;
 }
 
 rp_t fd_rp(int fd) {
+	struct fdtab *file;
+	uint32_t gen;
 	rp_t rp;
-	
-	mutex_spin(&_fdtab_mutex);
 
-	if (fd < 0 || _fdtab_size <= fd) {
-		rp = RP_NULL;
-	}
-	else {
-		rp = _fdtab[fd].rp;
+	file = _fd(fd);
+
+	if (!file) {
+		return RP_NULL;
 	}
 
-	mutex_free(&_fdtab_mutex);
+	do {
+		gen = _read_begin();
+		rp = file->rp;
+	} while (gen != fdtab_gen);
 
 	return rp;
 }
 
 int fd_seek(int fd, uint64_t pos) {
-	
-	mutex_spin(&_fdtab_mutex);
+	struct fdtab *file;
 
-	if (fd >= 0 && _fdtab_size > fd) {
-		_fdtab[fd].pos = pos;
-	
-		mutex_free(&_fdtab_mutex);
+	file = _fd(fd);
+
+	if (file) {
+		file->pos = pos;
 		return 0;
 	}
 
-	mutex_free(&_fdtab_mutex);
-
 	return -1;
 }
 
 uint64_t fd_pos(int fd) {
-	uint64_t pos;
-
-	mutex_spin(&_fdtab_mutex);
+	struct fdtab *file;
 
-	if (fd < 0 || _fdtab_size <= fd) {
-		pos = 0;
-	}
-	else {
-		pos = _fdtab[fd].pos;
-	}
-
-	mutex_free(&_fdtab_mutex);
+	file = _fd(fd);
 
-	return pos;
+	return (file) ? file->pos : 0;
 }
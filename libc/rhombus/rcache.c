@@ -0,0 +1,272 @@
+/*
+ * Copyright (C) 2012 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * 
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include <rho/mutex.h>
+#include <rho/natio.h>
+#include <rho/ipc.h>
+
+/*****************************************************************************
+ * rcall result cache
+ *
+ * Results of idempotent rcalls (type, size, get-key) are remembered
+ * per process, keyed by the target resource pointer and the argument 
+ * string. Drivers built on librdi remember which processes have asked 
+ * about each resource, and send those processes a "changed <rp>" event 
+ * whenever the type, size or keys of a resource change, and a "changed <rp>
+ * dir" event whenever the entries of a directory change. The former drops 
+ * every cached result for <rp>; the latter additionally drops every path
+ * lookup answered by the same driver from the path resolution cache (see 
+ * dcache.c), since a directory change can affect any path lookup that 
+ * passes through it.
+ *
+ * Entries are bucketed by resource pointer alone, so that flushing a single
+ * resource (which is done on every write) only walks one bucket. The cache
+ * holds at most RCACHE_MAX entries, and is simply dropped when it is full.
+ * Every flush advances a generation counter, so that a result whose rcall
+ * raced with a flush is not stored.
+ */
+
+#define RCACHE_BUCKETS 64
+#define RCACHE_MAX     512
+
+struct rcache_entry {
+	struct rcache_entry *next;
+	uint32_t hash;
+	rp_t  rp;
+	char *args;
+	char *rets;
+};
+
+static struct rcache_entry *_rcache[RCACHE_BUCKETS];
+static bool _rcache_mutex;
+static bool _rcache_hooked;
+static size_t _rcache_count;
+static uint32_t _rcache_gen;
+
+static uint32_t _bucket(rp_t rp) {
+	return (RP_PID(rp) * 31 + RP_INDEX(rp)) % RCACHE_BUCKETS;
+}
+
+static uint32_t _hash(const char *args) {
+	uint32_t hash = 0;
+
+	while (*args) {
+		hash = (hash << 5) - hash + (uint8_t) *args++;
+	}
+
+	return hash;
+}
+
+static void _free_entry(struct rcache_entry *entry) {
+	free(entry->args);
+	free(entry->rets);
+	free(entry);
+}
+
+/*
+ * Drops all cached results for <rp>, or all of them if <rp> is RP_NULL.
+ * The cache must be locked.
+ */
+
+static void _drop(rp_t rp) {
+	struct rcache_entry **prev, *entry;
+	int i;
+
+	for (i = 0; i < RCACHE_BUCKETS; i++) {
+		if (rp && (uint32_t) i != _bucket(rp)) {
+			continue;
+		}
+
+		prev = &_rcache[i];
+
+		while ((entry = *prev)) {
+			if (!rp || entry->rp == rp) {
+				*prev = entry->next;
+				_free_entry(entry);
+				_rcache_count--;
+			}
+			else {
+				prev = &entry->next;
+			}
+		}
+	}
+}
+
+static void _changed(rp_t src, int argc, char **argv) {
+	rp_t rp;
+
+	if (argc < 2) {
+		return;
+	}
+
+	rp = ator(argv[1]);
+	rcache_flush(rp);
+
+	if (argc == 3 && !strcmp(argv[2], "dir")) {
+		dcache_flush(RP_PID(rp));
+	}
+}
+
+/*****************************************************************************
+ * __rcache_hook
+ *
+ * Makes sure that change events are being listened for. This must be called
+ * before anything is cached that relies on them.
+ */
+
+void __rcache_hook(void) {
+
+	if (!_rcache_hooked) {
+		_rcache_hooked = true;
+		event_hook("changed", _changed);
+	}
+}
+
+/*****************************************************************************
+ * rcache_get
+ *
+ * Returns a copy of the cached result of rcall <args> to resource <rp>, or
+ * NULL if it is not cached.
+ */
+
+static char *rcache_get(rp_t rp, const char *args) {
+	struct rcache_entry *entry;
+	uint32_t hash;
+	char *rets;
+
+	hash = _hash(args);
+	rets = NULL;
+
+	mutex_spin(&_rcache_mutex);
+	for (entry = _rcache[_bucket(rp)]; entry; entry = entry->next) {
+		if (entry->hash == hash && entry->rp == rp && !strcmp(entry->args, args)) {
+			rets = strdup(entry->rets);
+			break;
+		}
+	}
+	mutex_free(&_rcache_mutex);
+
+	return rets;
+}
+
+/*****************************************************************************
+ * rcache_put
+ *
+ * Stores the result <rets> of rcall <args> to resource <rp> in the cache,
+ * unless the cache has been flushed since generation <gen>.
+ */
+
+static void rcache_put(rp_t rp, const char *args, const char *rets, uint32_t gen) {
+	struct rcache_entry *entry;
+
+	__rcache_hook();
+
+	entry = malloc(sizeof(struct rcache_entry));
+	if (!entry) return;
+
+	entry->hash = _hash(args);
+	entry->rp   = rp;
+	entry->args = strdup(args);
+	entry->rets = strdup(rets);
+
+	if (!entry->args || !entry->rets) {
+		_free_entry(entry);
+		return;
+	}
+
+	mutex_spin(&_rcache_mutex);
+
+	if (gen != _rcache_gen) {
+		// may be stale already
+		mutex_free(&_rcache_mutex);
+		_free_entry(entry);
+		return;
+	}
+
+	if (_rcache_count >= RCACHE_MAX) {
+		_drop(RP_NULL);
+	}
+
+	entry->next = _rcache[_bucket(rp)];
+	_rcache[_bucket(rp)] = entry;
+	_rcache_count++;
+	mutex_free(&_rcache_mutex);
+}
+
+/*****************************************************************************
+ * rcache_flush
+ *
+ * Drops all cached rcall results for resource <rp>. If <rp> is RP_NULL, the
+ * whole cache is dropped.
+ */
+
+void rcache_flush(rp_t rp) {
+
+	mutex_spin(&_rcache_mutex);
+
+	// even with nothing cached, a result may be on its way in
+	_rcache_gen++;
+
+	if (_rcache_count) {
+		_drop(rp);
+	}
+
+	mutex_free(&_rcache_mutex);
+}
+
+/*****************************************************************************
+ * rcall_cached
+ *
+ * Equivalent to rcall(), but for idempotent calls whose results only change
+ * when the resource announces it (type, size, get-key). Results are 
+ * served from the per-process rcall cache when possible; error results are
+ * never cached.
+ */
+
+char *rcall_cached(rp_t rp, rk_t key, const char *fmt, ...) {
+	va_list ap;
+	char *args;
+	char *rets;
+	uint32_t gen;
+
+	va_start(ap, fmt);
+	args = vsaprintf(fmt, ap);
+	va_end(ap);
+
+	if (!args) {
+		return NULL;
+	}
+
+	rets = rcache_get(rp, args);
+
+	if (!rets) {
+		gen = _rcache_gen;
+		rets = rcall(rp, key, "%s", args);
+
+		if (rets && !iserror(rets)) {
+			rcache_put(rp, args, rets, gen);
+		}
+	}
+
+	free(args);
+	return rets;
+}
@@ -39,7 +39,7 @@ uint64_t rp_getkey(rp_t rp, int action) {
 		return 0;
 	}
 
-	reply = rcall(rp, 0, "get-key %d", action);
+	reply = rcall_cached(rp, 0, "get-key %d", action);
 
 	if (iserror(reply)) {
 		errno = geterror(reply);
@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2012 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * 
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <stdio.h>
+
+/****************************************************************************
+ * __fcache
+ *
+ * Makes sure the resource pointer and read and write keys cached in 
+ * <stream> match its file descriptor, so that reads and writes don't have
+ * to look them up every time. They are refreshed whenever the descriptor 
+ * table has changed since they were cached. Used internally with the 
+ * stream's mutex held.
+ */
+
+void __fcache(FILE *stream) {
+	uint32_t gen;
+
+	gen = fdtab_gen;
+
+	if (stream->rp && stream->fdgen == gen) {
+		return;
+	}
+
+	stream->rp    = fd_rp(stream->fd);
+	stream->rkey  = fd_getkey(stream->fd, AC_READ);
+	stream->wkey  = fd_getkey(stream->fd, AC_WRITE);
+	stream->fdgen = gen;
+}
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009-2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2009-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -44,220 +44,341 @@
 #define LENGTH_LONG		3		// int or double
 #define LENGTH_LLONG	4		// long long int or long double
 
-static char *__format_uint(unsigned int value, int flags) {
-	char buffer[16];
-	int i;
-	int base;
+#define FORMAT_BUFFER	128		// conversion buffer (on stack)
+#define FORMAT_PREC_MAX	40		// maximum floating point precision
+#define FORMAT_FIX_MAX	1e40L	// larger values are always in %e form
 
-	const char *digits_lower = "0123456789abcdef";
-	const char *digits_upper = "0123456789ABCDEF";
-	const char *digits;
+/*****************************************************************************
+ * _put
+ *
+ * Emits <size> characters from <data> to <sink>. After a write fails, 
+ * further output is only counted.
+ */
 
-	if (flags & FLAG_OCTAL) 	base = 8;
-	else if (flags & FLAG_HEX) 	base = 16;
-	else 						base = 10;
+static void _put(struct __sink *sink, const char *data, size_t size) {
 
-	if (value == 0) {
-		return strdup("0");
+	if (size && !sink->error) {
+		if (sink->write(sink, data, size)) {
+			sink->error = 1;
+		}
 	}
 
-	if (flags & FLAG_UPPER) {
-		digits = digits_upper;
+	sink->count += size;
+}
+
+/*****************************************************************************
+ * _pad
+ *
+ * Emits <count> copies of the padding character <c> ('0' or ' ') to <sink>.
+ */
+
+static void _pad(struct __sink *sink, char c, size_t count) {
+	static const char spaces[] = "                ";
+	static const char zeroes[] = "0000000000000000";
+	const char *fill = (c == '0') ? zeroes : spaces;
+
+	while (count > sizeof(spaces) - 1) {
+		_put(sink, fill, sizeof(spaces) - 1);
+		count -= sizeof(spaces) - 1;
+	}
+
+	_put(sink, fill, count);
+}
+
+/*****************************************************************************
+ * _field
+ *
+ * Emits a converted field made of <prefix> (sign or radix marker), <zeros>
+ * leading zeroes (integer precision) and <length> characters of <body> to 
+ * <sink>, padded out to <width>.
+ */
+
+static void _field(struct __sink *sink, const char *prefix, size_t zeros,
+		const char *body, size_t length, int flags, size_t width) {
+	size_t plength = strlen(prefix);
+	size_t total = plength + zeros + length;
+	size_t pad;
+
+	pad = (total < width) ? width - total : 0;
+
+	if (flags & FLAG_LEFT) {
+		_put(sink, prefix, plength);
+		_pad(sink, '0', zeros);
+		_put(sink, body, length);
+		_pad(sink, ' ', pad);
+	}
+	else if (flags & FLAG_ZERO) {
+		_put(sink, prefix, plength);
+		_pad(sink, '0', pad + zeros);
+		_put(sink, body, length);
 	}
 	else {
-		digits = digits_lower;
+		_pad(sink, ' ', pad);
+		_put(sink, prefix, plength);
+		_pad(sink, '0', zeros);
+		_put(sink, body, length);
 	}
+}
 
-	buffer[15] = '\0';
-	for (i = 14; i >= 0; i--) {
-		if (!value) break;
-		buffer[i] = digits[value % base];
-		value /= base;
-	}
+/*****************************************************************************
+ * __format_div
+ *
+ * Divides <*value> by <base>, and returns the remainder. There is no 64-bit
+ * division in libc, so this is done in 16-bit pieces when needed.
+ */
 
-	if (flags & FLAG_SIGN) {
-		buffer[i--] = '+';
-	}
+static uint32_t __format_div(uint64_t *value, uint32_t base) {
+	uint32_t hi, lo, q1, q0, rem;
 
-	i++;
+	hi = *value >> 32;
+	lo = *value;
 
-	if (flags & FLAG_ALT) {
-		if (flags & FLAG_OCTAL) {
-			return strvcat("0", &buffer[i], NULL);
-		}
-		if (flags & FLAG_HEX) {
-			return strvcat((flags & FLAG_UPPER) ? "0X" : "0x", &buffer[i], NULL);
-		}
+	if (!hi) {
+		*value = lo / base;
+		return lo % base;
 	}
-	return strdup(&buffer[i]);
+
+	rem = hi % base;
+	hi  = hi / base;
+
+	q1  = (rem << 16) | (lo >> 16);
+	rem = q1 % base;
+	q1  = q1 / base;
+
+	q0  = (rem << 16) | (lo & 0xFFFF);
+	rem = q0 % base;
+	q0  = q0 / base;
+
+	*value = ((uint64_t) hi << 32) | (q1 << 16) | q0;
+	return rem;
 }
 
-static char *__format_int(int value, int flags) {
-	char *string, *temp;
+/*****************************************************************************
+ * __format_uint
+ *
+ * Writes the digits of <value> backwards, ending just before <end>, with at
+ * least <precision> digits. Returns the number of digits written. The caller
+ * must have room for <precision> digits, so user-supplied precisions are
+ * applied as padding instead (see _field).
+ */
 
-	if (value < 0) {
-		temp = __format_uint(-value, flags);
-		string = strvcat("-", temp, NULL);
-		free(temp);
+static size_t __format_uint(char *end, uint64_t value, int flags, int precision) {
+	const char *digits;
+	uint32_t base;
+	char *ptr = end;
+
+	if (flags & FLAG_OCTAL) 	base = 8;
+	else if (flags & FLAG_HEX) 	base = 16;
+	else 						base = 10;
+
+	digits = (flags & FLAG_UPPER) ? "0123456789ABCDEF" : "0123456789abcdef";
+
+	while (value) {
+		*--ptr = digits[__format_div(&value, base)];
 	}
-	else {
-		string = __format_uint(value, flags);
+
+	while (end - ptr < precision || ptr == end) {
+		*--ptr = '0';
 	}
 
-	return string;
+	return end - ptr;
 }
-	
-static char *__format_double_frac(long double value, int flags, int precision) {
-	char *string;
-	int i;
 
-	if (value < 0) value = -value;
-	if (value > 1) value -= floorl(value);
+/*****************************************************************************
+ * __format_fixed
+ *
+ * Writes <value> (non-negative, already rounded) to <buffer> in fixed point
+ * notation with <precision> fractional digits. Returns the length written.
+ */
+
+static size_t __format_fixed(char *buffer, long double value, int flags, int precision) {
+	long double ipart;
+	size_t length;
+	char digits[48];
+	int i, digit;
 
-	string = malloc(precision + 1);
+	ipart = floorl(value);
+	value -= ipart;
+
+	/* integer part */
+	if (ipart < 4294967296.0L) {
+		length = __format_uint(&digits[48], (uint32_t) ipart, 0, 1);
+	}
+	else {
+		for (length = 0; ipart >= 1 && length < sizeof(digits); length++) {
+			digits[47 - length] = (int) fmodl(ipart, 10) + '0';
+			ipart = floorl(ipart / 10);
+		}
+	}
+
+	memcpy(buffer, &digits[48 - length], length);
+
+	/* fractional part */
+	if (precision || flags & FLAG_ALT) {
+		buffer[length++] = '.';
+	}
 
 	for (i = 0; i < precision; i++) {
 		value *= 10;
-		string[i] = (int) value + '0';
-		value -= floorl(value);
+		digit = (int) value;
+		if (digit > 9) digit = 9;
+		value -= digit;
+		buffer[length++] = digit + '0';
+	}
 
-		if (value == 0.0 && !(flags & FLAG_ALT && flags & FLAG_MEXP)) {
-			i++;
-			break;
-		}
+	/* %g drops trailing zeroes unless in alternate form */
+	if (flags & FLAG_MEXP && !(flags & FLAG_ALT) && precision) {
+		while (buffer[length - 1] == '0') length--;
+		if (buffer[length - 1] == '.') length--;
 	}
-	
-	string[i] = '\0';
 
-	return string;
+	return length;
 }
 
-static char *__format_double_int(long double value, int flags) {
-	char *temp, *string;
+/*****************************************************************************
+ * __format_mant
+ *
+ * Splits <value> (non-negative) into a decimal exponent, which is returned,
+ * and a mantissa in [1, 10), stored in <*mant>, rounded to <precision> 
+ * fractional digits.
+ */
+
+static int __format_mant(long double value, long double *mant, int precision) {
 	int expt;
 
-	expt = log10l(value) + 1;
-	value /= (int) powl(10, expt);
+	if (value == 0) {
+		*mant = 0;
+		return 0;
+	}
 
-	temp = __format_double_frac(value, flags | FLAG_ALT | FLAG_MEXP, expt);
+	expt = (int) floorl(log10l(value));
+	value /= powl(10, expt);
 
-	if (value < 0) {
-		string = strvcat("-", temp, NULL);
-		free(temp);
+	if (value >= 10) {
+		value /= 10;
+		expt++;
 	}
-	else if (flags & FLAG_SIGN) {
-		string = strvcat("+", temp, NULL);
-		free(temp);
+	else if (value < 1) {
+		value *= 10;
+		expt--;
 	}
-	else {
-		string = temp;
+
+	value += 0.5L / powl(10, precision);
+
+	if (value >= 10) {
+		value /= 10;
+		expt++;
 	}
 
-	return string;
+	*mant = value;
+	return expt;
 }
 
-static char *__format_double(long double value, int flags, int precision) {
-	char *int_part;
-	char *dec_part;
-	char *string;
-	long double i;
+/*****************************************************************************
+ * __format_exp
+ *
+ * Writes <value> (non-negative) to <buffer> in scientific notation with 
+ * <precision> fractional digits. Returns the length written.
+ */
 
-	if (isnan(value)) {
-		if (flags & FLAG_UPPER) {
-			return strdup("NAN");
-		}
-		else {
-			return strdup("nan");
-		}
-	}
+static size_t __format_exp(char *buffer, long double value, int flags, int precision) {
+	long double mant;
+	size_t length, digits;
+	int expt;
 
-	if (isinf(value)) {
-		if (flags & FLAG_UPPER) {
-			if (value < 0) {
-				return strdup("-INF");
-			}
-			else {
-				if (flags & FLAG_SIGN) {
-					return strdup("+INF");
-				}
-				else {
-					return strdup("INF");
-				}
-			}
-		}
-		else {
-			if (value < 0) {
-				return strdup("-inf");
-			}
-			else {
-				if (flags & FLAG_SIGN) {
-					return strdup("+inf");
-				}
-				else {
-					return strdup("inf");
-				}
-			}
-		}
-	}
+	expt = __format_mant(value, &mant, precision);
+	length = __format_fixed(buffer, mant, flags, precision);
 
-	if (flags & FLAG_EXP || (flags & FLAG_MEXP && value > 1000000000)) {
-		i = log10l(value);
-		value /= powl(10, floorl(i));
+	buffer[length++] = (flags & FLAG_UPPER) ? 'E' : 'e';
+	buffer[length++] = (expt < 0) ? '-' : '+';
+	if (expt < 0) expt = -expt;
 
-		int_part = __format_double(value, flags & ~(FLAG_EXP), precision);
-		dec_part = __format_int(i, flags | FLAG_SIGN);
+	digits = __format_uint(&buffer[length + 8], expt, 0, 2);
+	memmove(&buffer[length], &buffer[length + 8 - digits], digits);
+	length += digits;
 
-		string = strvcat(int_part, (flags & FLAG_UPPER) ? "E" : "e", dec_part, NULL);
+	return length;
+}
+
+/*****************************************************************************
+ * __format_double
+ *
+ * Emits a floating point conversion of <value> to <sink>.
+ */
+
+static void __format_double(struct __sink *sink, long double value, int flags, 
+		size_t width, int precision) {
+	char buffer[FORMAT_BUFFER];
+	const char *prefix;
+	long double mant;
+	size_t length;
+	int expt;
 
-		free(int_part);
-		free(dec_part);
+	if (value < 0) {
+		prefix = "-";
+		value = -value;
 	}
 	else {
-		value = modfl(value, &i);
+		prefix = (flags & FLAG_SIGN) ? "+" : "";
+	}
 
-		if (value > 2000000000) {
-			int_part = __format_double_int(i, flags);
-		}
-		else {
-			int_part = __format_int(i, flags);
-		}
-		dec_part = __format_double_frac(value, flags, precision);
-
-		if (i == 0.0 && value < 0) {
-			if (value != 0.0 || flags & FLAG_ALT) {
-				string = strvcat("-", int_part, ".", dec_part, NULL);
-			}
-			else {
-				string = strvcat("-", int_part, NULL);
-			}
+	if (isnan(value) || isinf(value)) {
+		if (isnan(value)) prefix = "";
+		if (isnan(value)) strcpy(buffer, (flags & FLAG_UPPER) ? "NAN" : "nan");
+		else              strcpy(buffer, (flags & FLAG_UPPER) ? "INF" : "inf");
+		_field(sink, prefix, 0, buffer, 3, flags & ~FLAG_ZERO, width);
+		return;
+	}
+
+	if (precision < 0) precision = 6;
+	if (precision > FORMAT_PREC_MAX) precision = FORMAT_PREC_MAX;
+
+	if (flags & FLAG_MEXP) {
+		/* %g: <precision> significant digits, in whichever form fits */
+		if (precision == 0) precision = 1;
+
+		expt = __format_mant(value, &mant, precision - 1);
+
+		if (expt < -4 || expt >= precision) {
+			flags |= FLAG_EXP;
+			precision = precision - 1;
 		}
 		else {
-			if (value != 0.0 || flags & FLAG_ALT) {
-				string = strvcat(int_part, ".", dec_part, NULL);
-			}
-			else {
-				string = strdup(int_part);
-			}
+			precision = precision - 1 - expt;
 		}
+	}
 
-		free(int_part);
-		free(dec_part);
+	if (flags & FLAG_EXP || value >= FORMAT_FIX_MAX) {
+		length = __format_exp(buffer, value, flags, precision);
+	}
+	else {
+		value += 0.5L / powl(10, precision);
+		length = __format_fixed(buffer, value, flags, precision);
 	}
 
-	return string;
+	_field(sink, prefix, 0, buffer, length, flags, width);
 }
 
-char *__format(const char **_fmt, va_list *argp) {
+/*****************************************************************************
+ * __format_conv
+ *
+ * Parses the conversion specification at <fmt> (which points to a '%'), 
+ * reads its arguments from <argp>, and emits the converted value to <sink>.
+ * Returns a pointer to the first character after the specification. An
+ * invalid specification is emitted as-is.
+ */
+
+static const char *__format_conv(struct __sink *sink, const char *fmt, va_list *argp) {
+	char buffer[FORMAT_BUFFER];
+	const char *start = fmt;
+	const char *prefix;
 	int flags, type, length;
-	size_t width, precision;
-	const char *fmt = *_fmt;
-	char *string;
-	char *string1;
+	int width, precision;
+	size_t size, zeros;
 
-	uint64_t val_ll;
+	uint64_t val_u;
+	int64_t val_i;
 	long double val_d;
-	int val_i;
-	unsigned int val_u;
 	const char *val_s;
 	char val_c;
 
@@ -265,12 +386,7 @@ char *__format(const char **_fmt, va_list *argp) {
 	type  = 0;
 	width = 0;
 	length = LENGTH_LONG;
-	precision = 6;
-
-	/* check for '%' */
-	if (*fmt != '%') {
-		return NULL;
-	}
+	precision = -1;
 
 	/* read flags */
 	do {
@@ -280,7 +396,6 @@ char *__format(const char **_fmt, va_list *argp) {
 		case '-': flags |= FLAG_LEFT;  continue;
 		case '#': flags |= FLAG_ALT;   continue;
 		case '0': flags |= FLAG_ZERO;  continue;
-		case '\0': return NULL;
 		}
 		break;
 	} while (1);
@@ -288,27 +403,29 @@ char *__format(const char **_fmt, va_list *argp) {
 	/* read width */
 	if (*fmt == '*') {
 		width = va_arg(*argp, int);
+		if (width < 0) {
+			flags |= FLAG_LEFT;
+			width = -width;
+		}
 		fmt++;
 	}
-	else if (isdigit(*fmt)) {
-		width = atoi(fmt);
-		while (isdigit(*fmt)) fmt++;
+	else while (isdigit(*fmt)) {
+		width = width * 10 + (*fmt - '0');
+		fmt++;
 	}
 
 	/* read precision */
 	if (*fmt == '.') {
 		fmt++;
+		precision = 0;
 
 		if (*fmt == '*') {
 			precision = va_arg(*argp, int);
 			fmt++;
 		}
-		else if (isdigit(*fmt)) {
-			precision = atoi(fmt);
-			while (isdigit(*fmt)) fmt++;
-		}
-		else {
-			return NULL;
+		else while (isdigit(*fmt)) {
+			precision = precision * 10 + (*fmt - '0');
+			fmt++;
 		}
 	}
 
@@ -327,11 +444,11 @@ char *__format(const char **_fmt, va_list *argp) {
 	case 'l':
 		fmt++;
 		if (*fmt == 'l') {
-			length = LENGTH_LONG;
+			length = LENGTH_LLONG;
 			fmt++;
 		}
 		else {
-			length = LENGTH_LLONG;
+			length = LENGTH_LONG;
 		}
 		break;
 	case 'L': case 'j':
@@ -341,8 +458,7 @@ char *__format(const char **_fmt, va_list *argp) {
 	case 'z': case 't':
 		length = LENGTH_LONG;
 		fmt++;
-	case '\0':
-		return NULL;
+		break;
 	}
 
 	/* read type */
@@ -393,78 +509,121 @@ char *__format(const char **_fmt, va_list *argp) {
 		type = TYPE_LITERAL;
 		break;
 	default:
-		return NULL;
+		_put(sink, start, fmt - start);
+		return fmt;
 	}
+	fmt++;
 
-	/* read value */
-	switch (type) {
-	case TYPE_STRING:	val_s = va_arg(*argp, const char *); 	break;
-	case TYPE_CHAR:		val_c = va_arg(*argp, int); 			break;
-	case TYPE_LITERAL:	val_c = '%';							break;
-	case TYPE_INT:		val_i = va_arg(*argp, int);				break;
-	case TYPE_UINT:		val_u = va_arg(*argp, unsigned int);	break;
-	case TYPE_DOUBLE:
-		if (length == LENGTH_LLONG)	val_d = va_arg(*argp, long double);
-		else						val_d = va_arg(*argp, double);
-		break;
-	case TYPE_RP:		val_ll = va_arg(*argp, uint64_t);		break;
-	}
-
-	/* format value */
+	/* read, format, and emit value */
 	switch (type) {
 	case TYPE_STRING:
-		if (!val_s) string = strdup("(null)");
-		else string = strdup(val_s);
+		val_s = va_arg(*argp, const char *);
+		if (!val_s) val_s = "(null)";
+
+		for (size = 0; val_s[size]; size++) {
+			if (precision >= 0 && size >= (size_t) precision) break;
+		}
+
+		_field(sink, "", 0, val_s, size, flags, width);
 		break;
-	case TYPE_CHAR: case TYPE_LITERAL:
-		string = malloc(sizeof(char) * 2);
-		string[0] = val_c;
-		string[1] = '\0';
+	case TYPE_CHAR:
+		val_c = va_arg(*argp, int);
+		_field(sink, "", 0, &val_c, 1, flags, width);
+		break;
+	case TYPE_LITERAL:
+		_put(sink, "%", 1);
 		break;
 	case TYPE_INT:
-		string = __format_int(val_i, flags);
+		switch (length) {
+		case LENGTH_BYTE:  val_i = (signed char) va_arg(*argp, int); break;
+		case LENGTH_SHORT: val_i = (short) va_arg(*argp, int); break;
+		case LENGTH_LLONG: val_i = va_arg(*argp, long long); break;
+		default:           val_i = va_arg(*argp, int); break;
+		}
+
+		if (val_i < 0) prefix = "-";
+		else prefix = (flags & FLAG_SIGN) ? "+" : "";
+		if (precision >= 0) flags &= ~FLAG_ZERO;
+
+		val_u = (val_i < 0) ? -(uint64_t) val_i : (uint64_t) val_i;
+		/* only the digits go in the buffer; precision zeroes are padding */
+		size = __format_uint(&buffer[FORMAT_BUFFER], val_u, flags, 1);
+		zeros = (precision > 0 && (size_t) precision > size) ? precision - size : 0;
+		_field(sink, prefix, zeros, &buffer[FORMAT_BUFFER - size], size, flags, width);
 		break;
 	case TYPE_UINT:
-		string = __format_uint(val_u, flags);
+		switch (length) {
+		case LENGTH_BYTE:  val_u = (unsigned char) va_arg(*argp, unsigned int); break;
+		case LENGTH_SHORT: val_u = (unsigned short) va_arg(*argp, unsigned int); break;
+		case LENGTH_LLONG: val_u = va_arg(*argp, unsigned long long); break;
+		default:           val_u = va_arg(*argp, unsigned int); break;
+		}
+
+		prefix = "";
+		if (flags & FLAG_ALT && val_u) {
+			if (flags & FLAG_OCTAL) prefix = "0";
+			if (flags & FLAG_HEX) prefix = (flags & FLAG_UPPER) ? "0X" : "0x";
+		}
+		if (precision >= 0) flags &= ~FLAG_ZERO;
+
+		/* only the digits go in the buffer; precision zeroes are padding */
+		size = __format_uint(&buffer[FORMAT_BUFFER], val_u, flags, 1);
+		zeros = (precision > 0 && (size_t) precision > size) ? precision - size : 0;
+		_field(sink, prefix, zeros, &buffer[FORMAT_BUFFER - size], size, flags, width);
 		break;
 	case TYPE_DOUBLE:
-		string = __format_double(val_d, flags, precision);
+		if (length == LENGTH_LLONG)	val_d = va_arg(*argp, long double);
+		else						val_d = va_arg(*argp, double);
+
+		__format_double(sink, val_d, flags, width, precision);
 		break;
 	case TYPE_RP:
-		string = rtoa(val_ll);
+		val_u = va_arg(*argp, uint64_t);
+
+		/* same form as rtoa(), without the allocation */
+		size = FORMAT_BUFFER;
+		val_i = (int) RP_INDEX(val_u);
+		size -= __format_uint(&buffer[size], (val_i < 0) ? -val_i : val_i, 0, 1);
+		if (val_i < 0) buffer[--size] = '-';
+		buffer[--size] = '.';
+		val_i = (int) RP_PID(val_u);
+		size -= __format_uint(&buffer[size], (val_i < 0) ? -val_i : val_i, 0, 1);
+		if (val_i < 0) buffer[--size] = '-';
+		buffer[--size] = '@';
+
+		_field(sink, "", 0, &buffer[size], FORMAT_BUFFER - size, flags, width);
 		break;
 	}
 
-	if (strlen(string) < width) {
-		string1 = malloc(sizeof(char) * (width + 1));
+	return fmt;
+}
 
-		if (flags & FLAG_LEFT) {
-			strlcpy(string1, string, width + 1);
+/*****************************************************************************
+ * __vformat
+ *
+ * Formats <format> with the arguments <ap>, emitting the result piecewise
+ * to <sink>. Nothing is allocated; literal text goes to the sink in runs and
+ * each conversion is built in a small buffer on the stack. Returns the 
+ * number of characters emitted, or -1 if the sink reported an error.
+ */
 
-			if (flags & FLAG_ZERO) {
-				strlcat(string1, "000000000000000000000000", width + 1);
-			}
-			else {
-				strlcat(string1, "                        ", width + 1);
-			}
-		}
-		else {
-			if (flags & FLAG_ZERO) {
-				strlcpy(string1, "000000000000000000000000", width - strlen(string) + 1);
-			}
-			else {
-				strlcpy(string1, "                        ", width - strlen(string) + 1);
-			}
-
-			strlcat(string1, string, width + 1);
-		}
+int __vformat(struct __sink *sink, const char *format, va_list ap) {
+	const char *run;
+	va_list args;
 
-		free(string);
-	}
-	else {
-		string1 = string;
+	va_copy(args, ap);
+
+	while (*format) {
+
+		for (run = format; *format && *format != '%'; format++);
+		_put(sink, run, format - run);
+
+		if (*format == '%') {
+			format = __format_conv(sink, format, &args);
+		}
 	}
 
-	*_fmt = fmt;
-	return string1;
+	va_end(args);
+
+	return (sink->error) ? -1 : (int) sink->count;
 }
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009-2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2009-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -23,26 +23,48 @@
  * fflush
  *
  * Forces a write of all userspace-buffered data for the given output stream
- * via the stream's underlying write function.
+ * via the stream's underlying write function. For an input stream, discards
+ * any read-ahead data, so the next read goes to the underlying file.
  */
 
 int fflush(FILE *stream) {
-	size_t size;
+	int err;
 
 	if (!stream) {
 		return -1;
 	}
 
 	mutex_spin(&stream->mutex);
+	err = __fflush(stream);
+	mutex_free(&stream->mutex);
+
+	return err;
+}
 
-	if (stream->buffer && stream->buffpos) {
-		size = rp_write(fd_rp(stream->fd), fd_getkey(stream->fd, AC_WRITE), 
+/****************************************************************************
+ * __fflush
+ *
+ * Implementation of fflush() for callers that already hold the stream's 
+ * mutex. Afterwards, <stream>->position is the logical position of the 
+ * stream, and the stream buffer is empty.
+ */
+
+int __fflush(FILE *stream) {
+	size_t size;
+
+	if (stream->bufflen) {
+		/* discard read-ahead data */
+		stream->position += stream->buffpos;
+		stream->buffpos = 0;
+		stream->bufflen = 0;
+	}
+	else if (stream->buffer && stream->buffpos) {
+		__fcache(stream);
+		size = rp_write(stream->rp, stream->wkey, 
 			stream->buffer, stream->buffpos, stream->position);
 		stream->position += size;
 		stream->buffpos -= size;
 	}
 
-	mutex_free(&stream->mutex);
-
 	return 0;
 }
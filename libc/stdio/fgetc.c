@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009, 2010 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2009-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -16,15 +16,28 @@
 
 #include <stdio.h>
 
+#include <rho/mutex.h>
+
 /****************************************************************************
  * fgetc
  *
  * Reads the next character from <stream> and returns it cast to an int on 
- * success. Returns EOF on error.
+ * success. Returns EOF on error. If the character is already in the stream's
+ * read-ahead buffer, no I/O is done.
  */
 
 int fgetc(FILE *stream) {
-	int c = 0;
+	unsigned char c;
+
+	mutex_spin(&stream->mutex);
+
+	if (stream->revbuf == EOF && stream->buffpos < stream->bufflen) {
+		c = stream->buffer[stream->buffpos++];
+		mutex_free(&stream->mutex);
+		return c;
+	}
+
+	mutex_free(&stream->mutex);
 
 	if (fread(&c, sizeof(char), 1, stream) == 0) {
 		return EOF;
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009-2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2009-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -103,8 +103,20 @@ FILE *fopen(const char *path, const char *mode) {
 	stream->buffer   = NULL;
 	stream->buffsize = 0;
 	stream->buffpos  = 0;
+	stream->bufflen  = 0;
 	stream->revbuf   = EOF;
 	stream->flags    = FILE_NBF | FILE_READ;
+	stream->rp       = RP_NULL;
+
+	// read-only streams on files of known size are read ahead by default
+	if (mode[0] == 'r' && mode[1] != '+' && stream->size) {
+		stream->buffer = malloc(BUFSIZ);
+
+		if (stream->buffer) {
+			stream->buffsize = BUFSIZ;
+			stream->flags    = FILE_FBF | FILE_READ;
+		}
+	}
 
 	if (mode[0] == 'w' || mode[0] == 'a' || mode[1] == '+') {
 		stream->flags |= FILE_WRITE;
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009, 2010 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2009-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -14,6 +14,7 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <string.h>
 #include <stdio.h>
 
 #include <rho/natio.h>
@@ -25,38 +26,89 @@
  * Reads <nmemb> * <size> bytes of data from <stream> into the buffer <ptr>.
  * Returns the number of bytes / <size> successfully read; on error or EOF,
  * a lessened or zero value is returned.
+ *
+ * If the stream is buffered, small reads are served from the stream buffer,
+ * which is refilled with reads of the full buffer size; reads at least as
+ * large as the buffer go directly to the file.
  */
 
 size_t fread(void *ptr, size_t size, size_t nmemb, FILE *stream) {
-	size_t ret, rev_count;
-	char *cptr;
+	size_t ret, count;
+	uint8_t *cptr = ptr;
 
 	if (!stream) {
 		return 0;
 	}
 
 	nmemb *= size;
+	ret = 0;
 
 	mutex_spin(&stream->mutex);
+	__fcache(stream);
 
 	if ((stream->revbuf != EOF) && (nmemb != 0)) {
-		cptr = ptr;
-		cptr[0] = stream->revbuf;
-		ptr = &cptr[1];
+		cptr[ret++] = stream->revbuf;
 		stream->revbuf = EOF;
-		rev_count = 1;
 	}
-	else {
-		rev_count = 0;
+
+	if ((stream->flags & FILE_NBF) || !stream->buffer) {
+		count = rp_read(stream->rp, stream->rkey, 
+			&cptr[ret], nmemb - ret, stream->position);
+		stream->position += count;
+		ret += count;
+
+		if (ret != nmemb) {
+			stream->flags |= FILE_EOF;
+		}
 	}
+	else {
+		if (stream->buffpos && !stream->bufflen) {
+			/* write out pending data before reading */
+			__fflush(stream);
+		}
+
+		while (ret < nmemb) {
+
+			if (stream->buffpos < stream->bufflen) {
+				/* copy from read-ahead data */
+				count = stream->bufflen - stream->buffpos;
+				if (count > nmemb - ret) count = nmemb - ret;
+
+				memcpy(&cptr[ret], &stream->buffer[stream->buffpos], count);
+				stream->buffpos += count;
+				ret += count;
+				continue;
+			}
+
+			/* buffer is used up */
+			stream->position += stream->bufflen;
+			stream->buffpos = 0;
+			stream->bufflen = 0;
+
+			if (nmemb - ret >= stream->buffsize) {
+				/* large read: bypass buffer */
+				count = rp_read(stream->rp, stream->rkey, 
+					&cptr[ret], nmemb - ret, stream->position);
+				stream->position += count;
+				ret += count;
+
+				if (ret != nmemb) {
+					stream->flags |= FILE_EOF;
+				}
+				break;
+			}
+
+			/* refill buffer */
+			count = rp_read(stream->rp, stream->rkey, 
+				stream->buffer, stream->buffsize, stream->position);
 
-	ret = rp_read(fd_rp(stream->fd), fd_getkey(stream->fd, AC_READ), 
-		ptr, nmemb - rev_count, stream->position);
-	stream->position += ret;
-	ret += rev_count;
+			if (count == 0) {
+				stream->flags |= FILE_EOF;
+				break;
+			}
 
-	if (ret != nmemb) {
-		stream->flags |= FILE_EOF;
+			stream->bufflen = count;
+		}
 	}
 
 	if (size == 0) {
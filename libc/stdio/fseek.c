@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009, 2010 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2009-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -22,25 +22,38 @@
  * fseek
  *
  * Moves the file position of a stream to <offset> bytes from the position
- * specified by <whence>.
+ * specified by <whence>. Pending output is written out; read-ahead data is
+ * kept only if the new position lies within it.
  */
 
 int fseek(FILE *stream, fpos_t offset, int whence) {
-
-	fflush(stream);
+	fpos_t target;
 
 	mutex_spin(&stream->mutex);
 
 	switch (whence) {
 	case SEEK_CUR:
-		stream->position += offset;
+		target = stream->position + stream->buffpos + offset;
 		break;
 	case SEEK_END:
-		stream->position = stream->size - offset;
+		target = stream->size - offset;
 		break;
 	case SEEK_SET:
-		stream->position = offset;
+		target = offset;
 		break;
+	default:
+		mutex_free(&stream->mutex);
+		return -1;
+	}
+
+	if (stream->bufflen && target >= stream->position 
+			&& target <= stream->position + stream->bufflen) {
+		/* seek within read-ahead data */
+		stream->buffpos = target - stream->position;
+	}
+	else {
+		__fflush(stream);
+		stream->position = target;
 	}
 
 	mutex_free(&stream->mutex);
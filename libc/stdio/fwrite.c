@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009-2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2009-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -34,8 +34,7 @@ static int __nobufwrite(FILE *stream, void *data, size_t size);
  */
 
 size_t fwrite(const void *ptr, size_t size, size_t nmemb, FILE *stream) {
-	const uint8_t *data = ptr;
-	size_t i, ret, count;
+	size_t ret;
 	
 	if (!stream) {
 		return 0;
@@ -46,51 +45,63 @@ size_t fwrite(const void *ptr, size_t size, size_t nmemb, FILE *stream) {
 	}
 
 	mutex_spin(&stream->mutex);
+	ret = __fwrite(ptr, size * nmemb, stream);
+	mutex_free(&stream->mutex);
 
-	// no buffering
-	if (stream->flags & FILE_NBF) {
+	return (ret / size);
+}
 
-		ret = rp_write(fd_rp(stream->fd), fd_getkey(stream->fd, AC_WRITE),
-			(void*) ptr, size * nmemb, stream->position);
-		stream->position += ret;
+/****************************************************************************
+ * __fwrite
+ *
+ * Implementation of fwrite() for callers that already hold the stream's
+ * mutex. Writes <count> bytes from <ptr> to <stream>, and returns the 
+ * number of bytes successfully written.
+ */
 
-		if (size == 0) {
-			size = 1;
-		}
+size_t __fwrite(const void *ptr, size_t count, FILE *stream) {
+	const uint8_t *data = ptr;
+	size_t i, ret;
 
-		mutex_free(&stream->mutex);
+	__fcache(stream);
 
-		return (ret / size);
+	// discard read-ahead data
+	if (stream->bufflen) {
+		__fflush(stream);
+	}
+
+	// no buffering
+	if (stream->flags & FILE_NBF || !stream->buffer) {
+
+		ret = rp_write(stream->rp, stream->wkey,
+			(void*) ptr, count, stream->position);
+		stream->position += ret;
+
+		return ret;
 	}
 
 	// line buffering
 	if (stream->flags & FILE_LBF) {
 		
-		for (i = 0; i < size * nmemb; i++) {
+		for (i = 0; i < count; i++) {
 			stream->buffer[stream->buffpos++] = data[i];
 
 			if ((data[i] == '\n') || (stream->buffpos >= stream->buffsize)) {
 				if (__bufwrite(stream)) {
-					mutex_free(&stream->mutex);
 					return 0;
 				}
 			}
 		}
-		
-		mutex_free(&stream->mutex);
 
-		return nmemb;
+		return count;
 	}
 
 	// full buffering
-	count = size * nmemb;
 	if (stream->buffpos + count >= stream->buffsize) {
 		if (__bufwrite(stream)) {
-			mutex_free(&stream->mutex);
 			return 0;
 		}
 		if (__nobufwrite(stream, (void*) ptr, count)) {
-			mutex_free(&stream->mutex);
 			return 0;
 		}
 	}
@@ -98,10 +109,8 @@ size_t fwrite(const void *ptr, size_t size, size_t nmemb, FILE *stream) {
 		memcpy(&stream->buffer[stream->buffpos], (void*) ptr, count);
 		stream->buffpos += count;
 	}
-	
-	mutex_free(&stream->mutex);
 
-	return nmemb;
+	return count;
 }
 
 static int __bufwrite(FILE *stream) {
@@ -110,7 +119,7 @@ static int __bufwrite(FILE *stream) {
 	
 	for (pos = 0; pos < stream->buffpos;) {
 
-		count = rp_write(fd_rp(stream->fd), fd_getkey(stream->fd, AC_WRITE), 
+		count = rp_write(stream->rp, stream->wkey, 
 			stream->buffer, stream->buffpos - pos, stream->position);
 
 		if (count == 0) {
@@ -132,7 +141,7 @@ static int __nobufwrite(FILE *stream, void *data, size_t size) {
 	
 	for (pos = 0; pos < size;) {
 
-		count = rp_write(fd_rp(stream->fd), fd_getkey(stream->fd, AC_WRITE),
+		count = rp_write(stream->rp, stream->wkey,
 			data, size - pos, stream->position);
 
 		if (count == 0) {
@@ -23,7 +23,9 @@
 /****************************************************************************
  * setvbuf
  *
- * Set the buffering properties and buffer size of a stream.
+ * Set the buffering properties and buffer size of a stream. For input, the
+ * buffer size is also the read-ahead size: a buffered stream reads <size>
+ * bytes at a time from its file.
  */
 
 int setvbuf(FILE *stream, char *buf, int mode, size_t size) {
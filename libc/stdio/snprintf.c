@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009, 2010 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -14,15 +14,23 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
-#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
 
-void *memclr(void *s, size_t n) {
-	size_t i;
-	uint8_t *src = (uint8_t*) s;
+/****************************************************************************
+ * snprintf
+ *
+ * Prints a formatted string to <str>, writing at most <size> characters
+ * including the null terminator. See vsnprintf for details.
+ */
+
+int snprintf(char *str, size_t size, const char *format, ...) {
+	va_list ap;
+	int ret;
 
-	for (i = 0; i < n; i++) {
-		src[i] = 0;
-	}
+	va_start(ap, format);
+	ret = vsnprintf(str, size, format, ap);
+	va_end(ap);
 
-	return src;
+	return ret;
 }
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009-2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2009-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -19,21 +19,85 @@
 #include <string.h>
 #include <stdarg.h>
 
+#include <rho/mutex.h>
+
+/* stream sink; unbuffered streams are staged so each call is one write */
+struct _stream_sink {
+	struct __sink sink;
+	FILE  *stream;
+	size_t stagepos;
+	char   stage[256];
+};
+
+static int _stream_write(struct __sink *sink, const char *data, size_t size);
+static int _stream_flush(struct _stream_sink *sink);
+
+/****************************************************************************
+ * vfprintf
+ *
+ * Prints a formatted string to <stream>. The output is written directly
+ * into the stream's buffer while the stream is locked, so one call is never
+ * interleaved with output from other threads. Output to an unbuffered 
+ * stream is collected on the stack and written in as few writes as 
+ * possible. Returns the number of characters printed, or -1 on error.
+ */
+
 int vfprintf(FILE *stream, const char *format, va_list ap) {
-	char *string;
+	struct _stream_sink sink;
+	int ret;
 
 	if (!stream) {
 		return -1;
 	}
 
-	string = vsaprintf(format, ap);
+	sink.sink.write = _stream_write;
+	sink.sink.data  = &sink;
+	sink.sink.size  = (stream->flags & FILE_NBF || !stream->buffer) ? sizeof(sink.stage) : 0;
+	sink.sink.count = 0;
+	sink.sink.error = 0;
+	sink.stream     = stream;
+	sink.stagepos   = 0;
 
-	if (!string) {
-		return -1;
+	mutex_spin(&stream->mutex);
+	ret = __vformat(&sink.sink, format, ap);
+	if (_stream_flush(&sink)) {
+		ret = -1;
+	}
+	mutex_free(&stream->mutex);
+
+	return ret;
+}
+
+static int _stream_write(struct __sink *_sink, const char *data, size_t size) {
+	struct _stream_sink *sink = _sink->data;
+
+	if (!_sink->size) {
+		return (__fwrite(data, size, sink->stream) == size) ? 0 : -1;
 	}
 
-	fwrite(string, strlen(string), sizeof(char), stream);
-	free(string);
+	if (sink->stagepos + size > _sink->size) {
+		if (_stream_flush(sink)) {
+			return -1;
+		}
+		if (size > _sink->size) {
+			return (__fwrite(data, size, sink->stream) == size) ? 0 : -1;
+		}
+	}
+
+	memcpy(&sink->stage[sink->stagepos], data, size);
+	sink->stagepos += size;
+
+	return 0;
+}
+
+static int _stream_flush(struct _stream_sink *sink) {
+	size_t size = sink->stagepos;
+
+	sink->stagepos = 0;
+
+	if (size && __fwrite(sink->stage, size, sink->stream) != size) {
+		return -1;
+	}
 
 	return 0;
 }
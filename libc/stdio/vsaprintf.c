@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2009-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -18,10 +18,8 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
-#include <ctype.h>
 
-static void _string_adds(size_t *length, size_t *top, char **string, const char *s);
-static void _string_addc(size_t *length, size_t *top, char **string, char c);
+static int _string_write(struct __sink *sink, const char *data, size_t size);
 
 /****************************************************************************
  * vsaprintf
@@ -31,112 +29,52 @@ static void _string_addc(size_t *length, size_t *top, char **string, char c);
  */
 
 char *vsaprintf(const char *format, va_list ap) {
-	const char *format_tmp;
-	char *temp;
-	int i;
+	struct __sink sink;
 
-	char *string = NULL;
-	size_t length;
-	size_t top;
-
-	for (i = 0; format[i]; i++) {
-		if (format[i] == '%') {
-			format_tmp = &format[i];
-			temp = __format(&format_tmp, &ap);
-			_string_adds(&length, &top, &string, temp);
-			free(temp);
-			i = (uintptr_t) format_tmp - (uintptr_t) format;
-		}
-		else {
-			_string_addc(&length, &top, &string, format[i]);
-		}
-	}
-
-	return string;
-}
-
-/*****************************************************************************
- * _string_adds
- *
- * Add a string <s> to the string buffer <*string>, which is of length 
- * <*length> and has null byte at index <*top>.
- */
+	sink.write = _string_write;
+	sink.data  = NULL;
+	sink.size  = 0;
+	sink.count = 0;
+	sink.error = 0;
 
-static void _string_adds(size_t *length, size_t *top, char **string, const char *s) {
-	char *old_string;
-	size_t length_s;
-	size_t length2;
-	char *string2;
-	
-	length_s = strlen(s);
-
-	if (!*string) {
-		*string = strdup(s);
-		*length = length_s + 1;
-		*top    = length_s;
+	if (__vformat(&sink, format, ap) < 0) {
+		free(sink.data);
+		return NULL;
 	}
-	else {
-		if (*top + length_s >= *length) {
 
-			// reallocate string
-			length2 = *length * 2 + length_s;
-			string2 = malloc(length2);
+	if (!sink.data) {
+		return strdup("");
+	}
 
-			// copy to new string and concatenate
-			strcpy(string2, *string);
+	((char*) sink.data)[sink.count] = '\0';
 
-			// free old string
-			old_string = *string;
-			*string = string2;
-			*length = length2;
-			free(old_string);
-		}
-		
-		// concatenate strings
-		strcpy(&(*string)[*top], s);
-		*top += length_s;
-	}
+	return sink.data;
 }
 
 /*****************************************************************************
- * _string_addc
+ * _string_write
  *
- * Add a character <c> to the string buffer <*string>, which is of length 
- * <*length> and has null byte at index <*top>.
+ * Appends <size> characters from <data> to the string buffer of <sink>,
+ * growing it geometrically, always leaving room for the null terminator.
  */
 
-static void _string_addc(size_t *length, size_t *top, char **string, char c) {
-	char *old_string;
-	size_t length2;
-	char *string2;
-
-	if (!*string) {
-		*string = malloc(16);
-		*length = 16;
-		*top = 1;
-		(*string)[0] = c;
-		(*string)[1] = '\0';
-	}
-	else {
-		if (*top + 1 >= *length) {
-			
-			// reallocate string
-			length2 = *length * 2 + 1;
-			string2 = malloc(length2);
-
-			// copy to new string
-			memcpy(string2, *string, *length);
-
-			// free old string
-			old_string = *string;
-			*string = string2;
-			*length = length2;
-			free(old_string);
+static int _string_write(struct __sink *sink, const char *data, size_t size) {
+	size_t length;
+	char *string;
+
+	if (sink->count + size >= sink->size) {
+		length = sink->size * 2 + size + 16;
+		string = realloc(sink->data, length);
+
+		if (!string) {
+			return -1;
 		}
 
-		// add character
-		(*string)[*top] = c;
-		(*string)[*top+1] = '\0';
-		*top += 1;
+		sink->data = string;
+		sink->size = length;
 	}
+
+	memcpy(&((char*) sink->data)[sink->count], data, size);
+
+	return 0;
 }
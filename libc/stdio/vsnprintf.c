@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2012 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * 
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+static int _array_write(struct __sink *sink, const char *data, size_t size);
+
+/****************************************************************************
+ * vsnprintf
+ *
+ * Prints a formatted string to <str>, writing at most <size> characters
+ * including the null terminator. Returns the number of characters that 
+ * would have been printed had <size> been large enough, not including the
+ * null terminator.
+ */
+
+int vsnprintf(char *str, size_t size, const char *format, va_list ap) {
+	struct __sink sink;
+	int ret;
+
+	sink.write = _array_write;
+	sink.data  = str;
+	sink.size  = (size) ? size - 1 : 0;
+	sink.count = 0;
+	sink.error = 0;
+
+	ret = __vformat(&sink, format, ap);
+
+	if (size) {
+		str[(sink.count < sink.size) ? sink.count : sink.size] = '\0';
+	}
+
+	return ret;
+}
+
+static int _array_write(struct __sink *sink, const char *data, size_t size) {
+	char *str = sink->data;
+
+	if (sink->count >= sink->size) {
+		return 0;
+	}
+
+	if (size > sink->size - sink->count) {
+		size = sink->size - sink->count;
+	}
+
+	memcpy(&str[sink->count], data, size);
+
+	return 0;
+}
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009, 2010 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2009-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -15,40 +15,17 @@
  */
 
 #include <stdio.h>
-#include <ctype.h>
 #include <stdarg.h>
-#include <string.h>
-#include <stdlib.h>
+#include <stdint.h>
 
 /****************************************************************************
  * vsprintf
  *
- * XXX - doc
+ * Prints a formatted string to <str>, which must be large enough to hold
+ * it. Returns the number of characters printed, not including the null 
+ * terminator.
  */
 
 int vsprintf(char *str, const char *format, va_list ap) {
-	size_t i;
-	const char *format_tmp;
-	char m[2];
-	char *string;
-
-	strcpy(str, "");
-	m[1] = '\0';
-
-	for (i = 0; format[i]; i++) {
-		if (format[i] == '%') {
-			format_tmp = &format[i];
-			string = __format(&format_tmp, &ap);
-			i = (uintptr_t) format_tmp - (uintptr_t) format;
-			if (!string) continue;
-			strcat(str, string);
-			free(string);
-		}
-		else {
-			m[0] = format[i];
-			strcat(str, m);
-		}
-	}
-
-	return i;
+	return vsnprintf(str, SIZE_MAX, format, ap);
 }
@@ -0,0 +1,540 @@
+/*
+ * Copyright (C) 2012 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * 
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <rho/layout.h>
+#include <rho/mutex.h>
+#include <rho/page.h>
+#include <rho/arch.h>
+
+#include "malloc.h"
+
+static struct heap_page *_map;           /* heap map (page descriptors) */
+static uintptr_t         _base;          /* base address of heap */
+static uint32_t          _top;           /* pages below top of heap */
+static uint32_t          _map_top;       /* descriptors committed */
+static struct heap_page *_bin[HEAP_BINS];
+static struct heap_page *_kept[HEAP_BINS]; /* retained runs (still mapped) */
+static uint32_t          _kept_pages;
+static bool              _mutex;
+
+static struct heap_page *_take(size_t pages, size_t align, bool *mapped);
+static void _set_run(uint32_t index, uint32_t pages);
+static void _bin_add(struct heap_page *run, uint32_t index, uint32_t pages);
+static void _bin_del(struct heap_page *run);
+static int  _init(void);
+static int  _grow(uint32_t top);
+
+/*****************************************************************************
+ * heap_page_alloc
+ *
+ * Allocates a run of <pages> pages from the heap, aligned to a multiple of
+ * <align> pages. <align> must be a power of two. If a retained run of the 
+ * same length exists, it is reused as-is; otherwise, fresh memory is mapped
+ * at the run. The descriptor of the first page of the run is returned, with
+ * type HEAP_RUN. Returns null on out of memory error.
+ */
+
+struct heap_page *heap_page_alloc(size_t pages, size_t align) {
+	struct heap_page *run;
+	bool mapped;
+
+	run = _take(pages, align, &mapped);
+
+	if (!run) {
+		return NULL;
+	}
+
+	if (!mapped && page_anon(heap_page_addr(run), pages * PAGESZ, PROT_READ | PROT_WRITE)) {
+		heap_page_free(run, false);
+		return NULL;
+	}
+
+	return run;
+}
+
+/*****************************************************************************
+ * heap_page_resize
+ *
+ * Attempts to change the length of the allocated run <run> to <pages> pages
+ * without moving it. Shrinking always succeeds; the tail of the run is freed.
+ * Growing succeeds if the run is followed by a free run of sufficient length
+ * or is at the top of the heap, and fresh memory is mapped for the new pages.
+ * Returns zero on success, nonzero on failure.
+ */
+
+int heap_page_resize(struct heap_page *run, size_t pages) {
+	struct heap_page *next;
+	uint32_t index, old, extra;
+
+	index = run - _map;
+	old   = run->pages;
+
+	if (!pages || pages > HEAP_PAGES) {
+		return 1;
+	}
+
+	if (pages == old) {
+		return 0;
+	}
+
+	if (pages < old) {
+		/* split off tail and free it */
+		mutex_spin(&_mutex);
+		_set_run(index, pages);
+		_set_run(index + pages, old - pages);
+		mutex_free(&_mutex);
+
+		heap_page_free(&_map[index + pages], true);
+		return 0;
+	}
+
+	extra = pages - old;
+
+	mutex_spin(&_mutex);
+
+	if (index + old == _top) {
+		/* extend top of heap */
+		if (_top + extra > HEAP_PAGES || _grow(_top + extra)) {
+			mutex_free(&_mutex);
+			return 1;
+		}
+
+		_top += extra;
+	}
+	else {
+		/* absorb following free run */
+		next = &_map[index + old];
+
+		if (next->type != HEAP_FREE || next->pages < extra) {
+			mutex_free(&_mutex);
+			return 1;
+		}
+
+		_bin_del(next);
+
+		if (next->pages > extra) {
+			_bin_add(&_map[index + pages], index + pages, next->pages - extra);
+		}
+	}
+
+	_set_run(index, pages);
+
+	mutex_free(&_mutex);
+
+	if (page_anon(heap_page_addr(&_map[index + old]), extra * PAGESZ, PROT_READ | PROT_WRITE)) {
+		/* give back new pages (possibly partially mapped) */
+		page_free(heap_page_addr(&_map[index + old]), extra * PAGESZ);
+
+		mutex_spin(&_mutex);
+		_set_run(index, old);
+		_set_run(index + old, extra);
+		mutex_free(&_mutex);
+
+		heap_page_free(&_map[index + old], false);
+		return 1;
+	}
+
+	return 0;
+}
+
+/*****************************************************************************
+ * heap_page_move
+ *
+ * Moves the contents of the allocated run <run> to a new run of <pages> 
+ * pages by remapping its pages instead of copying them, then frees <run>.
+ * Any pages of the new run past the end of the old contents are fresh 
+ * memory. Returns the new run on success, null on failure; on failure, 
+ * <run> is left untouched.
+ */
+
+struct heap_page *heap_page_move(struct heap_page *run, size_t pages) {
+	struct heap_page *new;
+	uint32_t old;
+	bool mapped;
+	void *src, *dst;
+
+	old = run->pages;
+	new = _take(pages, 1, &mapped);
+
+	if (!new) {
+		return NULL;
+	}
+
+	src = heap_page_addr(run);
+	dst = heap_page_addr(new);
+
+	if (pages > old && !mapped) {
+		if (page_anon((uint8_t*) dst + old * PAGESZ, (pages - old) * PAGESZ, PROT_READ | PROT_WRITE)) {
+			heap_page_free(new, false);
+			return NULL;
+		}
+	}
+
+	/* link old frames at new run, then drop old mapping */
+	page_self(src, dst, ((pages < old) ? pages : old) * PAGESZ);
+	page_free(src, old * PAGESZ);
+	heap_page_free(run, false);
+
+	return new;
+}
+
+/*****************************************************************************
+ * heap_page_free
+ *
+ * Returns the run of pages starting at <run> to the heap. If <mapped> is 
+ * true, the run's memory is still mapped, and the run may be retained as-is
+ * for reuse as long as no more than HEAP_RETAIN pages are retained in total.
+ * Otherwise, the run is unmapped and merged with any free neighboring runs.
+ */
+
+void heap_page_free(struct heap_page *run, bool mapped) {
+	struct heap_page *next;
+	uint32_t index, pages;
+
+	index = run - _map;
+	pages = run->pages;
+
+	mutex_spin(&_mutex);
+
+	if (mapped && pages < HEAP_BINS && _kept_pages + pages <= HEAP_RETAIN) {
+		/* retain run */
+		run->type = HEAP_KEPT;
+		_map[index + pages - 1].type = HEAP_KEPT;
+		run->next = _kept[pages - 1];
+		_kept[pages - 1] = run;
+		_kept_pages += pages;
+
+		mutex_free(&_mutex);
+		return;
+	}
+
+	mutex_free(&_mutex);
+
+	/* unmap first, so the run cannot be reallocated while mapped */
+	if (mapped) {
+		page_free(heap_page_addr(run), pages * PAGESZ);
+	}
+
+	mutex_spin(&_mutex);
+
+	/* merge with previous run */
+	if (index > 0 && _map[index - 1].type == HEAP_FREE) {
+		index -= _map[index - 1].pages;
+		pages += _map[index].pages;
+		_bin_del(&_map[index]);
+	}
+
+	/* merge with next run */
+	if (index + pages < _top && _map[index + pages].type == HEAP_FREE) {
+		next = &_map[index + pages];
+		_bin_del(next);
+		pages += next->pages;
+	}
+
+	if (index + pages == _top) {
+		/* run is at top of heap: lower top */
+		_map[index].type = HEAP_NONE;
+		_map[index + pages - 1].type = HEAP_NONE;
+		_top = index;
+	}
+	else {
+		_bin_add(&_map[index], index, pages);
+	}
+
+	mutex_free(&_mutex);
+}
+
+/*****************************************************************************
+ * heap_page_stat
+ *
+ * Adds the page-level statistics of the heap to <stat>: mapped memory, page
+ * runs, and the slabs and objects of each size class. Objects held in thread
+ * caches are counted as in use.
+ */
+
+void heap_page_stat(struct mstat *stat) {
+	struct heap_page *page;
+	uint32_t index, objs, step;
+
+	mutex_spin(&_mutex);
+
+	stat->heap = (size_t) _top * PAGESZ;
+
+	for (index = 0; index < _top; index += step) {
+		page = &_map[index];
+		step = (page->type == HEAP_SLAB || !page->pages) ? 1 : page->pages;
+
+		switch (page->type) {
+		case HEAP_SLAB:
+			objs = PAGESZ / heap_class_size[page->class];
+			stat->mapped += PAGESZ;
+			stat->sizeclass[page->class].slabs++;
+			stat->sizeclass[page->class].in_use += page->count;
+			stat->sizeclass[page->class].free   += objs - page->count;
+			break;
+		case HEAP_RUN:
+			stat->mapped    += (size_t) page->pages * PAGESZ;
+			stat->runs      += 1;
+			stat->run_bytes += (size_t) page->pages * PAGESZ;
+			break;
+		case HEAP_KEPT:
+			stat->mapped    += (size_t) page->pages * PAGESZ;
+			stat->retained  += (size_t) page->pages * PAGESZ;
+			break;
+		case HEAP_FREE:
+			stat->free_runs  += 1;
+			stat->free_bytes += (size_t) page->pages * PAGESZ;
+			break;
+		default:
+			/* should not happen: skip page */
+			step = 1;
+			break;
+		}
+	}
+
+	mutex_free(&_mutex);
+}
+
+/*****************************************************************************
+ * heap_page_get
+ *
+ * Returns the descriptor of the heap page containing <ptr>, or null if <ptr>
+ * is not below the top of the heap. This function is thread-safe without
+ * locking: the heap map never moves once it has been created.
+ */
+
+struct heap_page *heap_page_get(const void *ptr) {
+	uintptr_t addr = (uintptr_t) ptr;
+
+	if (!_map || addr < _base || addr >= _base + (uintptr_t) _top * PAGESZ) {
+		return NULL;
+	}
+
+	return &_map[(addr - _base) / PAGESZ];
+}
+
+/*****************************************************************************
+ * heap_page_addr
+ *
+ * Returns the address of the heap page described by <page>.
+ */
+
+void *heap_page_addr(const struct heap_page *page) {
+	return (void*) (_base + (uintptr_t) (page - _map) * PAGESZ);
+}
+
+/*****************************************************************************
+ * _take
+ *
+ * Takes a run of <pages> pages aligned to <align> pages from the heap, and 
+ * marks it allocated. <mapped> is set to true if the run was retained and is
+ * still mapped. Returns null on out of memory error.
+ */
+
+static struct heap_page *_take(size_t pages, size_t align, bool *mapped) {
+	struct heap_page *run;
+	uint32_t index, bin, pad;
+
+	if (!pages || pages > HEAP_PAGES) {
+		return NULL;
+	}
+
+	mutex_spin(&_mutex);
+
+	if (!_map && _init()) {
+		mutex_free(&_mutex);
+		return NULL;
+	}
+
+	run = NULL;
+	*mapped = false;
+
+	if (align <= 1 && pages < HEAP_BINS && _kept[pages - 1]) {
+		/* reuse retained run: already mapped */
+		run = _kept[pages - 1];
+		_kept[pages - 1] = run->next;
+		_kept_pages -= pages;
+
+		_set_run(run - _map, pages);
+		*mapped = true;
+
+		mutex_free(&_mutex);
+		return run;
+	}
+
+	if (align <= 1) {
+		/* find smallest adequate free run */
+		for (bin = (pages < HEAP_BINS) ? pages - 1 : HEAP_BINS - 1; bin < HEAP_BINS; bin++) {
+			for (run = _bin[bin]; run; run = run->next) {
+				if (run->pages >= pages) break;
+			}
+			if (run) break;
+		}
+	}
+
+	if (run) {
+		/* split free run */
+		_bin_del(run);
+		index = run - _map;
+
+		if (run->pages > pages) {
+			_bin_add(&_map[index + pages], index + pages, run->pages - pages);
+		}
+	}
+	else {
+		/* extend top of heap */
+		pad = (align > 1) ? (align - ((_base / PAGESZ + _top) % align)) % align : 0;
+
+		if (_top + pad + pages > HEAP_PAGES || _grow(_top + pad + pages)) {
+			mutex_free(&_mutex);
+			return NULL;
+		}
+
+		if (pad) {
+			_bin_add(&_map[_top], _top, pad);
+		}
+
+		index = _top + pad;
+		_top  = index + pages;
+	}
+
+	_set_run(index, pages);
+
+	mutex_free(&_mutex);
+
+	return &_map[index];
+}
+
+/*****************************************************************************
+ * _set_run
+ *
+ * Marks the <pages> pages at <index> as an allocated run. This function is 
+ * not thread-safe.
+ */
+
+static void _set_run(uint32_t index, uint32_t pages) {
+	struct heap_page *run = &_map[index];
+
+	run->type  = HEAP_RUN;
+	run->pages = pages;
+	run->free  = NULL;
+	run->count = 0;
+
+	if (pages > 1) {
+		_map[index + pages - 1].type  = HEAP_TAIL;
+		_map[index + pages - 1].pages = pages;
+	}
+}
+
+/*****************************************************************************
+ * _bin_add
+ *
+ * Marks the <pages> pages at <index> as a free run and adds it to the proper
+ * bin. This function is not thread-safe.
+ */
+
+static void _bin_add(struct heap_page *run, uint32_t index, uint32_t pages) {
+	uint32_t bin;
+
+	bin = (pages < HEAP_BINS) ? pages - 1 : HEAP_BINS - 1;
+
+	run->type  = HEAP_FREE;
+	run->pages = pages;
+	_map[index + pages - 1].type  = HEAP_FREE;
+	_map[index + pages - 1].pages = pages;
+
+	run->prev = NULL;
+	run->next = _bin[bin];
+	if (_bin[bin]) _bin[bin]->prev = run;
+	_bin[bin] = run;
+}
+
+/*****************************************************************************
+ * _bin_del
+ *
+ * Removes the free run <run> from its bin. This function is not thread-safe.
+ */
+
+static void _bin_del(struct heap_page *run) {
+	uint32_t bin;
+
+	bin = (run->pages < HEAP_BINS) ? run->pages - 1 : HEAP_BINS - 1;
+
+	if (run->prev) run->prev->next = run->next;
+	else _bin[bin] = run->next;
+	if (run->next) run->next->prev = run->prev;
+}
+
+/*****************************************************************************
+ * _init
+ *
+ * Allocates the heap and heap map regions from the SLT. Returns zero on 
+ * success, nonzero on failure. This function is not thread-safe.
+ */
+
+static int _init(void) {
+	struct slt32_entry *slt;
+
+	if (!sltalloc("libc.heap", HEAP_SIZE) || !sltalloc("libc.heap_map", 
+			HEAP_PAGES * sizeof(struct heap_page))) {
+		return 1;
+	}
+
+	slt = sltget_name("libc.heap");
+	slt->flags    = SLT_FLAG_CLEANUP;
+	slt->type     = SLT_TYPE_ALLOC;
+	slt->sub_type = SLT_ALLOC_LIBC;
+	_base = slt->base;
+
+	slt = sltget_name("libc.heap_map");
+	slt->flags    = SLT_FLAG_CLEANUP;
+	slt->type     = SLT_TYPE_ALLOC;
+	slt->sub_type = SLT_ALLOC_LIBC;
+	_map = (void*) slt->base;
+
+	return 0;
+}
+
+/*****************************************************************************
+ * _grow
+ *
+ * Makes sure that the heap map has committed descriptors for all pages below
+ * <top>. New descriptors are zeroed (type HEAP_NONE). Returns zero on 
+ * success, nonzero on failure. This function is not thread-safe.
+ */
+
+static int _grow(uint32_t top) {
+	uintptr_t start, end;
+
+	if (top <= _map_top) {
+		return 0;
+	}
+
+	start = ((uintptr_t) &_map[_map_top] + PAGESZ - 1) & ~(PAGESZ - 1);
+	end   = ((uintptr_t) &_map[top] + PAGESZ - 1) & ~(PAGESZ - 1);
+
+	if (end > start && page_anon((void*) start, end - start, PROT_READ | PROT_WRITE)) {
+		return 1;
+	}
+
+	_map_top = (end - (uintptr_t) _map) / sizeof(struct heap_page);
+
+	return 0;
+}
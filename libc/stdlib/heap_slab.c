@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) 2012 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * 
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <stdlib.h>
+
+#include <rho/mutex.h>
+#include <rho/arch.h>
+
+#include "malloc.h"
+
+/*****************************************************************************
+ * heap_class_size
+ *
+ * Object sizes of the slab size classes: multiples of 16 up to 128, then 
+ * four classes between each pair of powers of two. Every power of two from 
+ * 16 to HEAP_SLAB_MAX is a class, so objects of those classes are naturally
+ * aligned to their size.
+ */
+
+const uint16_t heap_class_size[HEAP_CLASSES] = {
+	16,   32,   48,   64,   80,   96,   112,  128,
+	160,  192,  224,  256,  320,  384,  448,  512,
+	640,  768,  896,  1024, 1280, 1536, 1792, 2048,
+};
+
+static struct heap_page *_partial[HEAP_CLASSES];
+static bool              _mutex[HEAP_CLASSES];
+
+static void _partial_add(int class, struct heap_page *slab);
+static void _partial_del(int class, struct heap_page *slab);
+
+/*****************************************************************************
+ * heap_class
+ *
+ * Returns the smallest size class that can hold <size> bytes. <size> must
+ * not be greater than HEAP_SLAB_MAX.
+ */
+
+int heap_class(size_t size) {
+	size_t step;
+	int class;
+
+	if (size <= 128) {
+		return (size) ? (size - 1) / 16 : 0;
+	}
+
+	/* find power of two group */
+	for (class = 8, step = 32; size > step * 8; class += 4, step <<= 1);
+
+	return class + (size - step * 4 - 1) / step;
+}
+
+/*****************************************************************************
+ * heap_slab_alloc
+ *
+ * Allocates up to <count> objects of the size class <class>, links them 
+ * through their first word, and places the first in <list>. Returns the
+ * number of objects allocated, which is zero on out of memory error.
+ */
+
+size_t heap_slab_alloc(int class, void **list, size_t count) {
+	struct heap_page *slab;
+	uintptr_t base, size;
+	size_t n;
+	void *obj;
+
+	*list = NULL;
+	size  = heap_class_size[class];
+
+	mutex_spin(&_mutex[class]);
+
+	for (n = 0; n < count; n++) {
+
+		if (!_partial[class]) {
+			/* create new slab, without holding the lock */
+			mutex_free(&_mutex[class]);
+
+			slab = heap_page_alloc(1, 1);
+			if (!slab) {
+				return n;
+			}
+
+			slab->type  = HEAP_SLAB;
+			slab->class = class;
+			slab->count = 0;
+			slab->free  = NULL;
+
+			/* build free list (in address order) */
+			base = (uintptr_t) heap_page_addr(slab);
+			for (obj = (void*) (base + (PAGESZ / size - 1) * size); 
+					(uintptr_t) obj >= base; obj = (void*) ((uintptr_t) obj - size)) {
+				*(void**) obj = slab->free;
+				slab->free = obj;
+			}
+
+			mutex_spin(&_mutex[class]);
+			_partial_add(class, slab);
+		}
+
+		slab = _partial[class];
+
+		/* take object from slab */
+		obj = slab->free;
+		slab->free = *(void**) obj;
+		slab->count++;
+
+		if (!slab->free) {
+			/* slab is full */
+			_partial_del(class, slab);
+		}
+
+		*(void**) obj = *list;
+		*list = obj;
+	}
+
+	mutex_free(&_mutex[class]);
+
+	return n;
+}
+
+/*****************************************************************************
+ * heap_slab_free
+ *
+ * Returns the list of objects <list> of size class <class> to their slabs. 
+ * Slabs that become empty are returned to the page allocator, except for the
+ * last partial slab of the class.
+ */
+
+void heap_slab_free(int class, void *list) {
+	struct heap_page *slab;
+	struct heap_page *empty;
+	void *obj;
+
+	empty = NULL;
+
+	mutex_spin(&_mutex[class]);
+
+	while (list) {
+		obj  = list;
+		list = *(void**) obj;
+		slab = heap_page_get(obj);
+
+		if (!slab->free) {
+			/* slab was full */
+			_partial_add(class, slab);
+		}
+
+		*(void**) obj = slab->free;
+		slab->free = obj;
+		slab->count--;
+
+		if (!slab->count && (slab->next || slab->prev)) {
+			/* slab is empty and not the only partial slab */
+			_partial_del(class, slab);
+			slab->next = empty;
+			empty = slab;
+		}
+	}
+
+	mutex_free(&_mutex[class]);
+
+	while (empty) {
+		slab  = empty;
+		empty = slab->next;
+
+		slab->type  = HEAP_RUN;
+		slab->pages = 1;
+		heap_page_free(slab, true);
+	}
+}
+
+/*****************************************************************************
+ * _partial_add
+ *
+ * Adds <slab> to the list of partial slabs of <class>. This function is not
+ * thread-safe.
+ */
+
+static void _partial_add(int class, struct heap_page *slab) {
+	slab->prev = NULL;
+	slab->next = _partial[class];
+	if (_partial[class]) _partial[class]->prev = slab;
+	_partial[class] = slab;
+}
+
+/*****************************************************************************
+ * _partial_del
+ *
+ * Removes <slab> from the list of partial slabs of <class>. This function is
+ * not thread-safe.
+ */
+
+static void _partial_del(int class, struct heap_page *slab) {
+	if (slab->prev) slab->prev->next = slab->next;
+	else _partial[class] = slab->next;
+	if (slab->next) slab->next->prev = slab->prev;
+	slab->next = NULL;
+	slab->prev = NULL;
+}
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009-2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2009-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -19,22 +19,36 @@
 #include <stdio.h>
 #include <errno.h>
 
-#include <rho/layout.h>
-#include <rho/mutex.h>
-#include <rho/page.h>
 #include <rho/proc.h>
 #include <rho/arch.h>
 
 #include "malloc.h"
 
-static struct heap_node *_tree;
-static struct heap_node *_list[32];
-static bool   _mutex;
+/*****************************************************************************
+ * thread caches
+ *
+ * Each thread has a cache of free objects for each size class, indexed by
+ * thread id. A thread's cache is only ever touched by that thread, so it
+ * needs no locking; thread ids are reused, so a cache left behind by an 
+ * exited thread is inherited by the next thread with the same id. When a
+ * list grows past its limit, half of it is returned to the slabs.
+ */
+
+#define CACHE_BYTES	4096	/* per-class cache limit in bytes */
+#define CACHE_MIN	4		/* per-class cache limit in objects (minimum) */
+#define CACHE_MAX	64		/* per-class cache limit in objects (maximum) */
+
+struct heap_cache {
+	void    *list [HEAP_CLASSES];
+	uint16_t count[HEAP_CLASSES];
+};
 
-static void              _add_to_list  (struct heap_node *node);
-static struct heap_node *_get_by_addr  (uintptr_t addr);
-static struct heap_node *_find_node    (uintptr_t index);
-static uintptr_t          ilog2        (uintptr_t n);
+static struct heap_cache *_cache[MAX_THREADS];
+
+static void              *_malloc(size_t size);
+static struct heap_cache *_get_cache(void);
+static size_t             _cache_limit(int class);
+static uintptr_t          ilog2(uintptr_t n);
 
 /*****************************************************************************
  * aalloc
@@ -46,6 +60,13 @@ static uintptr_t          ilog2        (uintptr_t n);
  */
 
 void *aalloc(size_t size, size_t align) {
+	struct heap_page *run;
+	void *ptr;
+
+	if (size > HEAP_SIZE) {
+		errno = ENOMEM;
+		return NULL;
+	}
 
 	if (align) {
 		if (align != ((size_t) 1 << ilog2(align))) {
@@ -53,10 +74,33 @@ void *aalloc(size_t size, size_t align) {
 			return NULL;
 		}
 
-		size = (size > align) ? size : align;
+		if (align > 16) {
+			/* power of two size classes are aligned to their size */
+			size = (size > align) ? size : align;
+			size = (size_t) 1 << ilog2(size);
+		}
+	}
+
+	if (align <= PAGESZ) {
+		ptr = _malloc(size);
+	}
+	else {
+		/* page runs with more than page alignment */
+		run = heap_page_alloc((size + PAGESZ - 1) / PAGESZ, align / PAGESZ);
+
+		if (!run) {
+			errno = ENOMEM;
+			return NULL;
+		}
+
+		ptr = heap_page_addr(run);
 	}
 
-	return malloc(size);
+	if (mprof_period && ptr) {
+		mprof_alloc(ptr, size, __builtin_return_address(0));
+	}
+
+	return ptr;
 }
 
 /*****************************************************************************
@@ -67,30 +111,74 @@ void *aalloc(size_t size, size_t align) {
  */
 
 void *malloc(size_t size) {
-	struct heap_node *node;
-	uintptr_t index;
+	void *ptr;
+
+	ptr = _malloc(size);
+
+	if (mprof_period && ptr) {
+		mprof_alloc(ptr, size, __builtin_return_address(0));
+	}
+
+	return ptr;
+}
+
+/*****************************************************************************
+ * _malloc
+ *
+ * Allocates a block of size <size> from a thread cache, the slabs, or the 
+ * page allocator. Returns null on failure.
+ */
+
+static void *_malloc(size_t size) {
+	struct heap_cache *cache;
+	struct heap_page *run;
+	void *obj;
+	int class;
+
+	if (size <= HEAP_SLAB_MAX) {
+		class = heap_class(size);
+		cache = _get_cache();
+
+		if (!cache) {
+			/* no thread cache: allocate directly from slabs */
+			if (!heap_slab_alloc(class, &obj, 1)) {
+				errno = ENOMEM;
+				return NULL;
+			}
+			return obj;
+		}
+
+		if (!cache->list[class]) {
+			/* refill cache from slabs */
+			cache->count[class] = heap_slab_alloc(class, &cache->list[class], 
+				_cache_limit(class) / 2);
+
+			if (!cache->count[class]) {
+				errno = ENOMEM;
+				return NULL;
+			}
+		}
 
-	index = ilog2(size);
+		obj = cache->list[class];
+		cache->list[class] = *(void**) obj;
+		cache->count[class]--;
 
-	mutex_spin(&_mutex);
-	node = _find_node(index);
-	mutex_free(&_mutex);
+		return obj;
+	}
 
-	if (!node) {
+	if (size > HEAP_SIZE) {
 		errno = ENOMEM;
 		return NULL;
 	}
-	else {
-		node->status = 1;
 
-		if (page_anon((void*) node->base, 1 << index, PROT_READ | PROT_WRITE)) {
-			/* could not allocate memory */
-			errno = ENOMEM;
-			return NULL;
-		}
+	run = heap_page_alloc((size + PAGESZ - 1) / PAGESZ, 1);
 
-		return (void*) node->base;
+	if (!run) {
+		errno = ENOMEM;
+		return NULL;
 	}
+
+	return heap_page_addr(run);
 }
 
 /*****************************************************************************
@@ -100,27 +188,19 @@ void *malloc(size_t size) {
  */
 
 size_t msize(void *ptr) {
-	struct heap_node *node;
-	uintptr_t base = (uintptr_t) ptr;
-	size_t size;
-
-	mutex_spin(&_mutex);
+	struct heap_page *page;
 
-	// find matching node
-	node = _get_by_addr(base);
+	page = heap_page_get(ptr);
 
-	if (node && node->status == 1) {
-		// get size of block
-		size = (size_t) 1 << node->size;
+	if (!page) {
+		return 0;
 	}
-	else {
-		// block was freed or nonexistent
-		size = 0;
-	}
-
-	mutex_free(&_mutex);
 
-	return size;
+	switch (page->type) {
+	case HEAP_SLAB: return heap_class_size[page->class];
+	case HEAP_RUN:  return (size_t) page->pages * PAGESZ;
+	default:        return 0;
+	}
 }
 
 /*****************************************************************************
@@ -130,201 +210,230 @@ size_t msize(void *ptr) {
  */
 
 void free(void *ptr) {
-	struct heap_node *node;
-	uintptr_t base = (uintptr_t) ptr;
+	struct heap_cache *cache;
+	struct heap_page *page;
+	void *list, *last;
+	size_t i;
+	int class;
+
+	if (!ptr) {
+		// apparently, it is fine to free a NULL pointer in C; 
+		// don't emit errors on NULL frees.
+		return;
+	}
+
+	if (mprof_period) {
+		mprof_free(ptr);
+	}
 
-	mutex_spin(&_mutex);
-	node = _get_by_addr(base);
+	page = heap_page_get(ptr);
 
-	if (node) {
+	if (page && page->type == HEAP_SLAB) {
+		class = page->class;
 
-		// check for double frees
-		if (node->status == 0) {
-			mutex_free(&_mutex);
-			fprintf(stderr, "%d: double free (%x)\n", getpid(), base);
+		// check alignment within slab
+		if (((uintptr_t) ptr % PAGESZ) % heap_class_size[class]) {
+			fprintf(stderr, "%d: invalid free (%x)\n", getpid(), (uintptr_t) ptr);
 			abort();
 		}
 
-		// mark as freed
-		node->status = 0;
+		cache = _get_cache();
 
-		// return node to heap
-		_add_to_list(node);
+		if (!cache) {
+			*(void**) ptr = NULL;
+			heap_slab_free(class, ptr);
+			return;
+		}
 
-		// free memory
-		if (node->size >= 12) {
-			page_free((void*) node->base, (size_t) 1 << node->size);
+		// check for (immediate) double frees
+		if (cache->list[class] == ptr) {
+			fprintf(stderr, "%d: double free (%x)\n", getpid(), (uintptr_t) ptr);
+			abort();
 		}
-	}
-	else if (base) {
-		// apparently, it is fine to free a NULL pointer in C; 
-		// don't emit errors on NULL frees.
 
-		// node not found (i.e. pointer was not from heap)
-		mutex_free(&_mutex);
-		fprintf(stderr, "invalid free (%x)\n", base);
+		*(void**) ptr = cache->list[class];
+		cache->list[class] = ptr;
+		cache->count[class]++;
+
+		if (cache->count[class] > _cache_limit(class)) {
+			// return older half of cache to slabs
+			last = cache->list[class];
+			for (i = 1; i < cache->count[class] / 2; i++) {
+				last = *(void**) last;
+			}
+
+			list = *(void**) last;
+			*(void**) last = NULL;
+			cache->count[class] = i;
+
+			heap_slab_free(class, list);
+		}
+	}
+	else if (page && page->type == HEAP_RUN && !((uintptr_t) ptr % PAGESZ)) {
+		heap_page_free(page, true);
+	}
+	else if (page && (page->type == HEAP_FREE || page->type == HEAP_KEPT || page->type == HEAP_NONE)) {
+		fprintf(stderr, "%d: double free (%x)\n", getpid(), (uintptr_t) ptr);
+		abort();
+	}
+	else {
+		// block not found (i.e. pointer was not from heap)
+		fprintf(stderr, "%d: invalid free (%x)\n", getpid(), (uintptr_t) ptr);
 		abort();
 	}
-
-	mutex_free(&_mutex);
 }
 
-/****************************************************************************
- * ilog2
+/*****************************************************************************
+ * free_unmapped
  *
- * Returns the ceiling of the base 2 logarithm of the given integer. Uses a 
- * unrolled version of the algorithm detailed at 
- * <http://graphics.stanford.edu/~seander/bithacks.html#IntegerLog>.
+ * Returns the given pointer to the heap, like free(), for a block whose pages 
+ * have already been unmapped or given away by the caller (e.g. sent in a 
+ * message by msend()). The heap will not retain the block as mapped memory.
+ * Small blocks never have their own pages, and are simply freed.
  */
 
-static uintptr_t ilog2(uintptr_t n) {
-	register uintptr_t r = 0;
-	uintptr_t orig_n = n;
+void free_unmapped(void *ptr) {
+	struct heap_page *page;
 
-	if (n &   0xFFFF0000) {
-		n >>= 0x10;
-		r |=  0x10;
-	}
-	if (n &   0xFF00) {
-		n >>= 0x08;
-		r |=  0x08;
-	}
-	if (n &   0xF0) {
-		n >>= 0x04;
-		r |=  0x04;
-	}
-	if (n &   0xC) {
-		n >>= 0x02;
-		r |=  0x02;
-	}
-	if (n &   0x2) {
-		n >>= 0x01;
-		r |=  0x01;
-	}
+	page = heap_page_get(ptr);
 
-	if (((uintptr_t) 1 << r) == orig_n) {
-		return r;
+	if (page && page->type == HEAP_RUN && !((uintptr_t) ptr % PAGESZ)) {
+		if (mprof_period) {
+			mprof_free(ptr);
+		}
+
+		heap_page_free(page, false);
 	}
 	else {
-		return r + 1;
+		free(ptr);
 	}
 }
 
 /*****************************************************************************
- * _find_node
+ * mstat
  *
- * Returns a block of the size index <index>, allocated from the heap. If 
- * there is no adequate block in the free list, a larger block is split in
- * two: the lower half is returned and the higher half added to the free list.
- * Returns null on out of memory error.
+ * Fills <stat> with statistics about the current state of the heap. The
+ * statistics are a snapshot: other threads may be allocating and freeing
+ * while they are collected. Returns zero on success, nonzero on failure.
  */
 
-static struct heap_node *_find_node(uintptr_t index) {
-	struct heap_node *node;
-	struct slt32_entry *slt;
+int mstat(struct mstat *stat) {
+	struct heap_cache *cache;
+	size_t i, class;
 
-	if (index >= 32) {
-		return NULL;
+	if (!stat) {
+		return 1;
 	}
 
-	if (!_tree) {
-		// construct new tree (only happens on first allocation)
-		_tree = new_heap_node();
+	memclr(stat, sizeof(struct mstat));
 
-		sltalloc("libc.heap", 0x20000000);
-		slt = sltget_name("libc.heap");
+	for (class = 0; class < HEAP_CLASSES; class++) {
+		stat->sizeclass[class].size = heap_class_size[class];
+	}
 
-		slt->flags    = SLT_FLAG_CLEANUP;
-		slt->type     = SLT_TYPE_ALLOC;
-		slt->sub_type = SLT_ALLOC_LIBC;
+	heap_page_stat(stat);
 
-		_tree->base = slt->base;
-		_tree->size = ilog2(0x20000000);
-		
-		_tree->status = 0;
+	/* objects in thread caches are free, not in use */
+	for (i = 0; i < MAX_THREADS; i++) {
+		cache = _cache[i];
+		if (!cache) continue;
 
-		_add_to_list(_tree);
+		for (class = 0; class < HEAP_CLASSES; class++) {
+			stat->sizeclass[class].cached += cache->count[class];
+			stat->sizeclass[class].in_use -= cache->count[class];
+		}
 	}
 
-	node = _list[index];
-	if (node) {
-		// adequate node exists: remove from list and return
-		_list[index] = node->next;
-		if (_list[index]) _list[index]->prev = NULL;
-		return node;
+	stat->in_use = stat->run_bytes;
+	for (class = 0; class < HEAP_CLASSES; class++) {
+		stat->in_use += stat->sizeclass[class].in_use * heap_class_size[class];
 	}
-	else {
-		// allocate larger node
-		node = _find_node(index + 1);
-		if (!node) {
-			// could not allocate larger node: heap must be OOM
+
+	return 0;
+}
+
+/*****************************************************************************
+ * _get_cache
+ *
+ * Returns the current thread's cache, allocating it if it does not exist.
+ * Returns null if the cache could not be allocated.
+ */
+
+static struct heap_cache *_get_cache(void) {
+	struct heap_cache *cache;
+	uint32_t tid;
+	void *obj;
+
+	tid = gettid();
+	cache = _cache[tid];
+
+	if (!cache) {
+		if (!heap_slab_alloc(heap_class(sizeof(struct heap_cache)), &obj, 1)) {
 			return NULL;
 		}
-		else {
-			// construct new left node
-			node->left = new_heap_node();
-			node->left->left   = NULL;
-			node->left->right  = NULL;
-			node->left->parent = node;
-			node->left->base   = node->base;
-			node->left->size   = index;
-			node->left->status = 0;
-
-			// construct new right node
-			node->right = new_heap_node();
-			node->right->left   = NULL;
-			node->right->right  = NULL;
-			node->right->parent = node;
-			node->right->base   = node->base + (1 << index);
-			node->right->size   = index;
-			node->right->status = 0;
-			
-			// save right node for later use
-			_add_to_list(node->right);
-
-			// return left node
-			return node->left;
-		}
+
+		cache = obj;
+		memclr(cache, sizeof(struct heap_cache));
+		_cache[tid] = cache;
 	}
+
+	return cache;
 }
 
 /*****************************************************************************
- * _add_to_list
+ * _cache_limit
  *
- * Adds the block <node> to the proper free list. This function is not
- * thread-safe.
+ * Returns the maximum number of free objects of size class <class> kept in
+ * a thread cache.
  */
 
-static void _add_to_list(struct heap_node *node) {
-	node->next = _list[node->size];
-	node->prev = NULL;
-	if (_list[node->size]) _list[node->size]->prev = node;
-	_list[node->size] = node;
+static size_t _cache_limit(int class) {
+	size_t limit;
+
+	limit = CACHE_BYTES / heap_class_size[class];
+
+	if (limit < CACHE_MIN) return CACHE_MIN;
+	if (limit > CACHE_MAX) return CACHE_MAX;
+	return limit;
 }
 
-/*****************************************************************************
- * _get_by_addr
+/****************************************************************************
+ * ilog2
  *
- * Searches the heap for an allocated block with base address <addr>. Returns
- * the found block on success, null on failure. This function is not 
- * thread-safe.
+ * Returns the ceiling of the base 2 logarithm of the given integer. Uses a 
+ * unrolled version of the algorithm detailed at 
+ * <http://graphics.stanford.edu/~seander/bithacks.html#IntegerLog>.
  */
 
-static struct heap_node *_get_by_addr(uintptr_t addr) {
-	struct heap_node *root;
-
-	root = _tree;
+static uintptr_t ilog2(uintptr_t n) {
+	register uintptr_t r = 0;
+	uintptr_t orig_n = n;
 
-	while (root) {
-		if (root->left && root->right) {
-			// not a leaf: choose child by address
-			root = (addr < root->right->base) ? root->left : root->right;
-		}
-		else {
-			// leaf: return if match
-			return (addr == root->base) ? root : NULL;
-		}
+	if (n &   0xFFFF0000) {
+		n >>= 0x10;
+		r |=  0x10;
+	}
+	if (n &   0xFF00) {
+		n >>= 0x08;
+		r |=  0x08;
+	}
+	if (n &   0xF0) {
+		n >>= 0x04;
+		r |=  0x04;
+	}
+	if (n &   0xC) {
+		n >>= 0x02;
+		r |=  0x02;
+	}
+	if (n &   0x2) {
+		n >>= 0x01;
+		r |=  0x01;
 	}
 
-	return NULL;
+	if (((uintptr_t) 1 << r) == orig_n) {
+		return r;
+	}
+	else {
+		return r + 1;
+	}
 }
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2011-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -18,42 +18,98 @@
 #define STDLIB_MALLOC_H
 
 #include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <rho/arch.h>
 
 /*****************************************************************************
  * dynamic memory allocator layout
- * 
- * The heap is divided into two sections: one for allocating heap nodes, and
- * one for general use. The former section is from HEAP2_START to HEAP2_END,
- * and the latter is from HEAP_START to HEAP_END.
+ *
+ * The heap is a single region of HEAP_SIZE bytes allocated from the SLT,
+ * managed in pages. Every page of the heap has a descriptor (struct 
+ * heap_page) in a second region, the heap map, so the owner of any heap 
+ * address can be found without touching the heap itself.
+ *
+ * Allocations of up to HEAP_SLAB_MAX bytes are rounded up to one of
+ * HEAP_CLASSES size classes and carved from single-page slabs of objects of
+ * that class. Larger allocations are runs of whole pages. Each thread keeps
+ * a small cache of free objects of each class in front of the slabs, so most
+ * small allocations and frees take no locks at all.
  */
 
-#define HEAP_START 	0x10000000
-#define HEAP_END	0x30000000
+#define HEAP_SIZE		0x20000000
+#define HEAP_PAGES		(HEAP_SIZE / PAGESZ)
 
-#define HEAP2_START HEAP_END
-#define HEAP2_END	(HEAP_END + 0x1000000)
+#define HEAP_CLASSES	MSTAT_CLASSES
+#define HEAP_SLAB_MAX	2048
+#define HEAP_BINS		32
+#define HEAP_RETAIN		32	/* freed pages kept mapped for reuse */
+#define HEAP_REMAP		8	/* runs this long are moved by remapping */
+
+/* page descriptor types */
+#define HEAP_NONE	0	/* never used, or interior of a run */
+#define HEAP_FREE	1	/* head or tail of a free run */
+#define HEAP_RUN	2	/* head of an allocated run */
+#define HEAP_TAIL	3	/* tail of an allocated run */
+#define HEAP_SLAB	4	/* slab of small objects */
+#define HEAP_KEPT	5	/* head or tail of a retained (mapped) free run */
+
+struct heap_page {
+	struct heap_page *next; /* free run bin or partial slab list */
+	struct heap_page *prev;
+
+	void    *free;  /* slab: list of free objects */
+	uint32_t pages; /* run: length in pages (at head and tail of run) */
+	uint16_t count; /* slab: number of objects not in slab free list */
+	uint8_t  type;
+	uint8_t  class;
+};
 
 /*****************************************************************************
- * internal allocator
+ * size classes
+ */
+
+extern const uint16_t heap_class_size[HEAP_CLASSES];
+
+int heap_class(size_t size);
+
+/*****************************************************************************
+ * page run allocator
  *
- * Allocates only elements of the type struct heap_node.
+ * Allocates runs of pages from the heap. Free runs are coalesced with their
+ * neighbors and kept in bins by length. Up to HEAP_RETAIN pages of freed 
+ * runs are kept mapped and reused by length, so that repeatedly allocating
+ * and freeing a page-sized block (e.g. a message) makes no system calls.
  */
 
-struct heap_node {
-	struct heap_node *next;
-	struct heap_node *prev;
+struct heap_page *heap_page_alloc(size_t pages, size_t align);
+void              heap_page_free (struct heap_page *page, bool mapped);
+int               heap_page_resize(struct heap_page *page, size_t pages);
+struct heap_page *heap_page_move (struct heap_page *page, size_t pages);
+void              heap_page_stat (struct mstat *stat);
+struct heap_page *heap_page_get  (const void *ptr);
+void             *heap_page_addr (const struct heap_page *page);
 
-	struct heap_node *parent;
-	struct heap_node *left;
-	struct heap_node *right;
+/*****************************************************************************
+ * slab allocator
+ *
+ * Allocates and frees lists of objects of a single size class, linked 
+ * through their first word.
+ */
 
-	uintptr_t status; // 1 if allocated, 0 if free
-	uintptr_t base;   // base address
-	uintptr_t size;   // base 2 logarithm of size in bytes
-};
+size_t heap_slab_alloc(int class, void **list, size_t count);
+void   heap_slab_free (int class, void *list);
+
+/*****************************************************************************
+ * allocation profiler
+ *
+ * When <mprof_period> is nonzero, every <mprof_period>th allocation is 
+ * recorded with its call site, and frees of recorded blocks are tracked.
+ */
+
+extern uint32_t mprof_period;
 
-struct heap_node *new_heap_node(void);
-void del_heap_node(struct heap_node *node);
+void mprof_alloc(void *ptr, size_t size, void *caller);
+void mprof_free (void *ptr);
 
 #endif/*STDLIB_MALLOC_H*/
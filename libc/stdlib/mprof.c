@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2012 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * 
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <rho/mutex.h>
+
+#include "malloc.h"
+
+/*****************************************************************************
+ * sampling allocation profiler
+ *
+ * Call sites are kept in a small hash table keyed by return address; if it
+ * fills up, further sites are lumped together under caller zero. Sampled
+ * blocks are kept in a second table so that their frees can be attributed
+ * to the right site. A block is only sampled if it can be tracked, so the
+ * live counts stay exact. The sample counter is not locked: racing threads
+ * may occasionally skip or repeat a sample, which does not matter here.
+ */
+
+#define MPROF_SITES	64
+#define MPROF_LIVE	1024
+#define MPROF_PROBE	4
+
+uint32_t mprof_period;
+
+static uint32_t _counter;
+static bool     _mutex;
+
+static struct mprof_site _site[MPROF_SITES];
+
+static struct mprof_live {
+	void    *ptr;
+	size_t   size;
+	uint32_t site;
+} _live[MPROF_LIVE];
+
+static uint32_t _hash(uintptr_t value) {
+	value ^= value >> 16;
+	value *= 0x45D9F3B;
+	value ^= value >> 16;
+	return value;
+}
+
+/*****************************************************************************
+ * mprofile
+ *
+ * Starts sampling every <period>th allocation, discarding all previously 
+ * collected samples. If <period> is zero, stops sampling.
+ */
+
+void mprofile(uint32_t period) {
+
+	mutex_spin(&_mutex);
+
+	memclr(_site, sizeof(_site));
+	memclr(_live, sizeof(_live));
+	_counter = 0;
+	mprof_period = period;
+
+	mutex_free(&_mutex);
+}
+
+/*****************************************************************************
+ * mprofile_read
+ *
+ * Copies up to <count> call site records with at least one sample into the
+ * array <site>. Returns the number of records copied.
+ */
+
+size_t mprofile_read(struct mprof_site *site, size_t count) {
+	size_t i, n;
+
+	mutex_spin(&_mutex);
+
+	for (i = 0, n = 0; i < MPROF_SITES && n < count; i++) {
+		if (_site[i].samples) {
+			site[n++] = _site[i];
+		}
+	}
+
+	mutex_free(&_mutex);
+
+	return n;
+}
+
+/*****************************************************************************
+ * mprof_alloc
+ *
+ * Counts an allocation of the block <ptr> of <size> bytes from call site 
+ * <caller>, and records it if it is to be sampled.
+ */
+
+void mprof_alloc(void *ptr, size_t size, void *caller) {
+	struct mprof_site *site;
+	uint32_t i, j, h;
+
+	if (!mprof_period || ++_counter % mprof_period) {
+		return;
+	}
+
+	mutex_spin(&_mutex);
+
+	/* find free slot for block */
+	h = _hash((uintptr_t) ptr);
+	for (i = 0; i < MPROF_PROBE; i++) {
+		if (!_live[(h + i) % MPROF_LIVE].ptr) break;
+	}
+
+	if (i == MPROF_PROBE) {
+		/* cannot track block: don't sample it */
+		mutex_free(&_mutex);
+		return;
+	}
+
+	/* find call site (the last site is reserved for overflow) */
+	h = _hash((uintptr_t) caller);
+	for (j = 0; j < MPROF_SITES - 1; j++) {
+		site = &_site[(h + j) % (MPROF_SITES - 1)];
+		if (site->caller == (uintptr_t) caller || !site->samples) break;
+	}
+
+	if (j == MPROF_SITES - 1) {
+		site = &_site[MPROF_SITES - 1];
+		caller = NULL;
+	}
+
+	site->caller = (uintptr_t) caller;
+	site->samples++;
+	site->live++;
+	site->bytes += size;
+	site->live_bytes += size;
+
+	h = _hash((uintptr_t) ptr);
+	_live[(h + i) % MPROF_LIVE].ptr  = ptr;
+	_live[(h + i) % MPROF_LIVE].size = size;
+	_live[(h + i) % MPROF_LIVE].site = site - _site;
+
+	mutex_free(&_mutex);
+}
+
+/*****************************************************************************
+ * mprof_free
+ *
+ * Counts a free of the block <ptr>, if it was sampled.
+ */
+
+void mprof_free(void *ptr) {
+	struct mprof_live *live;
+	uint32_t i, h;
+
+	mutex_spin(&_mutex);
+
+	h = _hash((uintptr_t) ptr);
+	for (i = 0; i < MPROF_PROBE; i++) {
+		live = &_live[(h + i) % MPROF_LIVE];
+
+		if (live->ptr == ptr) {
+			_site[live->site].live--;
+			_site[live->site].live_bytes -= live->size;
+			live->ptr = NULL;
+			break;
+		}
+	}
+
+	mutex_free(&_mutex);
+}
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009, 2010 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2009-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * Copyright (C) 2011 Jaagup Repän <jrepan at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
@@ -16,55 +16,380 @@
  */
 
 #include <stdlib.h>
-#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <rho/mutex.h>
+#include <rho/proc.h>
+
+#define QSORT_INSERT	16		// partitions this small use insertion sort
+#define QSORT_MT_MIN	4096	// partitions this small are not handed off
+#define QSORT_MT_JOBS	64		// maximum queued partitions per sort
+
+typedef int (*qsort_cmp_t)(const void *, const void *);
+
+/****************************************************************************
+ * _swap
+ *
+ * Exchanges the elements <a> and <b> of size <size> in place, a word at a 
+ * time when the elements allow it.
+ */
+
+static inline void _swap(uint8_t *a, uint8_t *b, size_t size) {
+	uint32_t t32;
+	uint8_t t8;
+
+	if (!(size & 3) && !(((uintptr_t) a | (uintptr_t) b) & 3)) {
+		for (; size; size -= 4, a += 4, b += 4) {
+			t32 = *(uint32_t*) a;
+			*(uint32_t*) a = *(uint32_t*) b;
+			*(uint32_t*) b = t32;
+		}
+	}
+	else {
+		for (; size; size--, a++, b++) {
+			t8 = *a;
+			*a = *b;
+			*b = t8;
+		}
+	}
+}
+
+/****************************************************************************
+ * _insertion_sort
+ *
+ * Sorts the <n> elements at <base> by insertion. Used for small partitions,
+ * where it beats partitioning.
+ */
+
+static void _insertion_sort(uint8_t *base, size_t n, size_t size, qsort_cmp_t cmp) {
+	uint8_t *i, *j;
+	uint8_t *end = base + n * size;
+
+	for (i = base + size; i < end; i += size) {
+		for (j = i; j > base && cmp(j - size, j) > 0; j -= size) {
+			_swap(j - size, j, size);
+		}
+	}
+}
+
+/****************************************************************************
+ * _heap_sort
+ *
+ * Sorts the <n> elements at <base> with heapsort. Used when partitioning
+ * goes too deep, which bounds the worst case at O(n log n).
+ */
+
+static void _sift_down(uint8_t *base, size_t root, size_t n, size_t size, qsort_cmp_t cmp) {
+	size_t child;
+
+	while ((child = root * 2 + 1) < n) {
+
+		if (child + 1 < n && cmp(base + child * size, base + (child + 1) * size) < 0) {
+			child++;
+		}
+
+		if (cmp(base + root * size, base + child * size) >= 0) {
+			return;
+		}
+
+		_swap(base + root * size, base + child * size, size);
+		root = child;
+	}
+}
+
+static void _heap_sort(uint8_t *base, size_t n, size_t size, qsort_cmp_t cmp) {
+	size_t i;
+
+	for (i = n / 2; i > 0; i--) {
+		_sift_down(base, i - 1, n, size, cmp);
+	}
+
+	for (i = n - 1; i > 0; i--) {
+		_swap(base, base + i * size, size);
+		_sift_down(base, 0, i, size, cmp);
+	}
+}
+
+/****************************************************************************
+ * _partition
+ *
+ * Partitions the <n> elements at <base> around the median of the first,
+ * middle and last elements. Returns the final index of the pivot; every
+ * element before it compares less than or equal to it, and every element
+ * after it greater than or equal to it.
+ */
+
+static size_t _partition(uint8_t *base, size_t n, size_t size, qsort_cmp_t cmp) {
+	uint8_t *lo  = base;
+	uint8_t *mid = base + (n / 2) * size;
+	uint8_t *hi  = base + (n - 1) * size;
+	size_t i, j;
+
+	/* median of three: order lo <= mid <= hi */
+	if (cmp(mid, lo) < 0) _swap(mid, lo, size);
+	if (cmp(hi, mid) < 0) {
+		_swap(hi, mid, size);
+		if (cmp(mid, lo) < 0) _swap(mid, lo, size);
+	}
+
+	/* keep the pivot at base[0]; base[n - 1] stops the upward scan */
+	_swap(lo, mid, size);
+
+	i = 0;
+	j = n;
+	while (1) {
+		do i++; while (i < n - 1 && cmp(base + i * size, base) < 0);
+		do j--; while (cmp(base + j * size, base) > 0);
+
+		if (i >= j) {
+			break;
+		}
+
+		_swap(base + i * size, base + j * size, size);
+	}
+
+	_swap(base, base + j * size, size);
+
+	return j;
+}
+
+/****************************************************************************
+ * _introsort
+ *
+ * Sorts the <n> elements at <base>, falling back to heapsort after <depth>
+ * levels of partitioning. Only the smaller side of each partition is 
+ * sorted recursively, so the stack depth is O(log n).
+ */
+
+static void _introsort(uint8_t *base, size_t n, size_t size, qsort_cmp_t cmp, int depth) {
+	size_t p;
+
+	while (n > QSORT_INSERT) {
+
+		if (depth-- == 0) {
+			_heap_sort(base, n, size, cmp);
+			return;
+		}
+
+		p = _partition(base, n, size, cmp);
+
+		if (p < n - p - 1) {
+			_introsort(base, p, size, cmp, depth);
+			base += (p + 1) * size;
+			n -= p + 1;
+		}
+		else {
+			_introsort(base + (p + 1) * size, n - p - 1, size, cmp, depth);
+			n = p;
+		}
+	}
+
+	_insertion_sort(base, n, size, cmp);
+}
+
+static int _depth(size_t n) {
+	int depth;
+
+	for (depth = 0; n > 1; n >>= 1) depth += 2;
+
+	return depth;
+}
 
 /****************************************************************************
  * qsort
  *
  * Sorts the array <base> containing <nmemb> elements of size <size> in
- * ascending order based on <cmp>.
+ * ascending order based on <cmp>. This is an introsort: median-of-three
+ * quicksort with insertion sort for small partitions and heapsort if
+ * partitioning degenerates. It does not allocate memory.
  */
 
 void qsort(void *base, size_t nmemb, size_t size, int(*compar)(const void *, const void*)) {
-	if (nmemb <= 1) {
+
+	if (nmemb <= 1 || !size) {
 		return;
 	}
 
-	size_t left = 0;
-	size_t right = nmemb - 1;
-	void *pivot = malloc(size);
-	void *t = malloc(size);
-	memcpy(pivot, (uint8_t*) base + (left + right) / 2 * size, size);
+	_introsort(base, nmemb, size, compar, _depth(nmemb));
+}
 
-	while (1) {
-		// Find items to swap
-		while (left < nmemb && compar((uint8_t*) base + left * size, pivot) < 0) {
-			left++;
+/****************************************************************************
+ * parallel sort
+ *
+ * A sort in progress is described by a struct qsort_mt on the caller's
+ * stack. Its partitions larger than QSORT_MT_MIN are queued there, and any
+ * participating thread (the caller or a helper) may take one, split it,
+ * queue one side and keep the other. Helper threads started by also() 
+ * cannot take arguments, so they find the sort through a global list.
+ */
+
+struct qsort_job {
+	uint8_t *base;
+	size_t n;
+	int depth;
+};
+
+struct qsort_mt {
+	struct qsort_mt *next;
+
+	size_t size;
+	qsort_cmp_t cmp;
+
+	bool mutex;
+	struct qsort_job job[QSORT_MT_JOBS];
+	size_t jobs;       // queued partitions
+	size_t pending;    // queued or in-progress partitions
+	size_t helpers;    // helper threads still attached
+};
+
+static struct qsort_mt *_sorts;
+static bool _sorts_mutex;
+
+static void _mt_run(struct qsort_mt *sort, struct qsort_job job) {
+	size_t p, n;
+	uint8_t *base;
+
+	while (job.n > QSORT_MT_MIN && job.depth > 0) {
+		p = _partition(job.base, job.n, sort->size, sort->cmp);
+		job.depth--;
+
+		/* queue the smaller side, if there is room */
+		if (p < job.n - p - 1) {
+			base = job.base;
+			n = p;
+			job.base += (p + 1) * sort->size;
+			job.n -= p + 1;
 		}
-		while (right > 0 && compar((uint8_t*) base + right * size, pivot) > 0) {
-			right--;
+		else {
+			base = job.base + (p + 1) * sort->size;
+			n = job.n - p - 1;
+			job.n = p;
 		}
 
-		if (left >= right) {
-			// all items are divided
-			break;
+		mutex_spin(&sort->mutex);
+		if (sort->jobs < QSORT_MT_JOBS) {
+			sort->job[sort->jobs].base  = base;
+			sort->job[sort->jobs].n     = n;
+			sort->job[sort->jobs].depth = job.depth;
+			sort->jobs++;
+			sort->pending++;
+			mutex_free(&sort->mutex);
+		}
+		else {
+			mutex_free(&sort->mutex);
+			_introsort(base, n, sort->size, sort->cmp, job.depth);
+		}
+	}
+
+	_introsort(job.base, job.n, sort->size, sort->cmp, job.depth);
+
+	mutex_spin(&sort->mutex);
+	sort->pending--;
+	mutex_free(&sort->mutex);
+}
+
+static void _mt_work(struct qsort_mt *sort) {
+	struct qsort_job job;
+	bool taken;
+
+	while (sort->pending) {
+
+		mutex_spin(&sort->mutex);
+		taken = false;
+		if (sort->jobs) {
+			job = sort->job[--sort->jobs];
+			taken = true;
 		}
-		if (compar((uint8_t*) base + left * size, (uint8_t*) base + right * size) == 0) {
-			// skip equal items
-			left++;
-			continue;
+		mutex_free(&sort->mutex);
+
+		if (taken) {
+			_mt_run(sort, job);
 		}
+		else {
+			sleep();
+		}
+	}
+}
+
+static void _mt_helper(void) {
+	struct qsort_mt *sort;
+
+	while (1) {
+
+		/* find an unfinished sort and attach to it */
+		mutex_spin(&_sorts_mutex);
+		for (sort = _sorts; sort; sort = sort->next) {
+			if (sort->pending) break;
+		}
+		if (sort) {
+			mutex_spin(&sort->mutex);
+			sort->helpers++;
+			mutex_free(&sort->mutex);
+		}
+		mutex_free(&_sorts_mutex);
+
+		if (!sort) {
+			done();
+		}
+
+		_mt_work(sort);
 
-		// ... and swap them
-		memcpy(t, (uint8_t*) base + right * size, size);
-		memcpy((uint8_t*) base + right * size, (uint8_t*) base + left * size, size);
-		memcpy((uint8_t*) base + left * size, t, size);
+		mutex_spin(&sort->mutex);
+		sort->helpers--;
+		mutex_free(&sort->mutex);
 	}
+}
+
+/****************************************************************************
+ * qsort_mt
+ *
+ * Sorts like qsort(), but hands partitions to up to <threads> - 1 helper
+ * threads, plus the calling thread. This only pays off when the kernel 
+ * runs threads of one process in parallel; with <threads> <= 1 or small
+ * arrays, it is exactly qsort().
+ */
+
+void qsort_mt(void *base, size_t nmemb, size_t size, 
+		int (*compar)(const void *, const void *), size_t threads) {
+	struct qsort_mt sort, **link;
+	size_t i;
+
+	if (threads <= 1 || nmemb <= QSORT_MT_MIN) {
+		qsort(base, nmemb, size, compar);
+		return;
+	}
+
+	sort.size    = size;
+	sort.cmp     = compar;
+	sort.mutex   = false;
+	sort.jobs    = 1;
+	sort.pending = 1;
+	sort.helpers = 0;
+
+	sort.job[0].base  = base;
+	sort.job[0].n     = nmemb;
+	sort.job[0].depth = _depth(nmemb);
+
+	mutex_spin(&_sorts_mutex);
+	sort.next = _sorts;
+	_sorts = &sort;
+	mutex_free(&_sorts_mutex);
 
-	free(pivot);
-	free(t);
+	for (i = 1; i < threads; i++) {
+		if (also(_mt_helper) == (uint32_t) -1) break;
+	}
+
+	/* work alongside the helpers until every partition is sorted */
+	_mt_work(&sort);
 
-	// sort items less than pivot and greater than pivot recursively
-	qsort(base, left, size, compar);
-	qsort((uint8_t*) base + (left + 1) * size, nmemb - left - 1, size, compar);
+	/* detach, and wait for helpers to let go of the sort */
+	mutex_spin(&_sorts_mutex);
+	for (link = &_sorts; *link != &sort; link = &(*link)->next);
+	*link = sort.next;
+	mutex_free(&_sorts_mutex);
+
+	while (sort.helpers) {
+		sleep();
+	}
 }
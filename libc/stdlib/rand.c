@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009-2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2009-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -18,6 +18,7 @@
 #include <string.h>
 
 #include <rho/mutex.h>
+#include <rho/proc.h>
 
 /****************************************************************************
  * TT800S RNG for Rhombus
@@ -28,14 +29,24 @@
  */
 
 /****************************************************************************
- * rand_state
+ * rand_seed, rand_epoch
  *
- * State of the random number generator.
+ * Seed of the global random number generator. Each thread keeps its own
+ * generator state in its thread-local segment (at TLS_RAND), so rand() never
+ * takes a lock; rand_epoch is bumped by srand() to make every thread reseed
+ * from rand_seed on its next call. rand_epoch is odd while srand() is in the
+ * middle of an update.
  */
 
-static uint32_t *rand_state = NULL;
+static volatile uint32_t rand_seed  = 1;
+static volatile uint32_t rand_epoch = 2;
 static bool rand_mutex;
 
+struct rand_tls {
+	uint32_t epoch;
+	uint32_t state[26];
+};
+
 /****************************************************************************
  * rand_regen
  *
@@ -77,14 +88,86 @@ static const uint32_t rand_salt[25] = {
 	0x512C0C03,	0xEA857CCD,	0x4CC1D30F,	0x8891A9A1,	0xA6B7AADB
 };
 
+/****************************************************************************
+ * rand_init
+ *
+ * Seeds the generator state <state> with <seed>. The seed is run through a 
+ * LCG taken from the Public Domain C Library, xor'ed with the elements of 
+ * rand_salt, and then placed into the state of the random number generator.
+ * The generator state is then regenerated, to minimize nonrandomness 
+ * produced by the less uniform LCG.
+ */
+
+static void rand_init(uint32_t *state, uint32_t seed) {
+	size_t i;
+
+	for (i = 0; i < 25; i++) {
+		seed = seed * 0x41C64E6D + 0x3039;
+		state[i] = seed ^ rand_salt[i];
+
+		/* on the off chance... */
+		if (state[i] == 0) {
+			state[i] = rand_salt[i];
+		}
+	}
+
+	rand_regen(state);
+
+	/* set index to 0 */
+	state[25] = 0;
+}
+
+/****************************************************************************
+ * rand_temper
+ *
+ * Tempers a raw state word to ensure uniform distribution across bits.
+ */
+
+static inline uint32_t rand_temper(uint32_t value) {
+
+	value ^= (value << 7)  & 0x2B5B2500;
+	value ^= (value << 15) & 0xDB8B0000;
+	value ^= (value >> 16);
+
+	return value;
+}
+
+/****************************************************************************
+ * rand_local
+ *
+ * Returns the current thread's generator state, reseeding it first if 
+ * srand() has been called since the thread last used it. The state lives 
+ * in the thread-local segment, which the kernel zero-fills on first touch,
+ * so a fresh thread always starts with a stale epoch. Each thread's seed 
+ * is the global seed mixed with its thread ID; thread 0 uses the global 
+ * seed unchanged, so single-threaded programs see the same sequence they 
+ * always did.
+ */
+
+static uint32_t *rand_local(void) {
+	struct rand_tls *tls = (void*) (gettls() + TLS_RAND);
+	uint32_t epoch, seed;
+
+	if (tls->epoch == rand_epoch) {
+		return tls->state;
+	}
+
+	do {
+		epoch = rand_epoch;
+		seed  = rand_seed;
+	} while ((epoch & 1) || epoch != rand_epoch);
+
+	rand_init(tls->state, seed ^ (gettid() * 0x9E3779B9));
+	tls->epoch = epoch;
+
+	return tls->state;
+}
+
 /****************************************************************************
  * srand
  *
- * Seeds the random number generator. The seed is run through a LCG taken
- * from the Public Domain C Library, xor'ed with the elements of rand_salt,
- * and then placed into the state of the random number generator. The
- * generator state is then regenerated, to minimize nonrandomness produced
- * by the less uniform LCG.
+ * Seeds the random number generator. Every thread's generator is reseeded
+ * from <seed> the next time it is used.
  *
  * If the given seed is 1, the generator is put into the same state as it was 
  * when the library was originally initialized. Or, more precisely, when the
@@ -96,11 +179,9 @@ void srand(uint32_t seed) {
 
 	mutex_spin(&rand_mutex);
 
-	if (rand_state) {
-		free(rand_state);
-	}
-
-	rand_state = srands(seed);
+	rand_epoch++;
+	rand_seed = seed;
+	rand_epoch++;
 
 	mutex_free(&rand_mutex);
 }
@@ -108,25 +189,12 @@ void srand(uint32_t seed) {
 /****************************************************************************
  * rand
  *
- * Returns a random number in the range 0 to RAND_MAX.
- *
- * Initializes the random number generator with a seed of 1 if it has not
- * yet been initialized. Regenerates the generator's state using rand_regen
- * if all values of the state have been used. Tempers the resulting value to
- * ensure uniform distribution across bits.
+ * Returns a random number in the range 0 to RAND_MAX from the current 
+ * thread's generator. Does not lock.
  */
 
 uint32_t rand(void) {
-	uint32_t value;
-
-	mutex_spin(&rand_mutex);
-
-	if (!rand_state) rand_state = srands(1);
-	value = rands(rand_state);
-
-	mutex_free(&rand_mutex);
-
-	return value;
+	return rands(rand_local());
 }
 
 /*****************************************************************************
@@ -134,14 +202,11 @@ uint32_t rand(void) {
  *
  * Using the random number generator, randomizes the first n bytes of the
  * memory region pointed to by p. The probability of any bit being 1 in that
- * region is 1/2 and independent of all other bits.
+ * region is 1/2 and independent of all other bits. Does not lock.
  */
 
 void memrand(void *p, size_t n) {
-
-	mutex_spin(&rand_mutex);
-	memrands(p, n, rand_state);
-	mutex_free(&rand_mutex);
+	memrands(p, n, rand_local());
 }
 
 /*****************************************************************************
@@ -172,27 +237,12 @@ uint32_t randmod(uint32_t n, uint32_t mod) {
 
 void *srands(uint32_t seed) {
 	uint32_t *state;
-	size_t i;
 
 	/* allocate state */
 	state = malloc(sizeof(uint32_t) * 26);
 	if (!state) return NULL;
 
-	/* seed allocator */
-	for (i = 0; i < 25; i++) {
-		seed = seed * 0x41C64E6D + 0x3039;
-		state[i] = seed ^ rand_salt[i];
-
-		/* on the off chance... */
-		if (state[i] == 0) {
-			state[i] = rand_salt[i];
-		}
-	}
-
-	rand_regen(state);
-
-	/* set index to 0 */
-	state[25] = 0;
+	rand_init(state, seed);
 
 	return state;
 }
@@ -205,24 +255,16 @@ void *srands(uint32_t seed) {
  */
 
 uint32_t rands(void *state) {
-	uint32_t value;
 	uint32_t *state32 = state;
 
 	if (!state) return 0;
 
 	if (state32[25] >= 25) {
-		rand_regen(state);
+		rand_regen(state32);
 		state32[25] = 0;
 	}
 
-	value = state32[state32[25]];
-	state32[25]++;
-
-	value ^= (value << 7)  & 0x2B5B2500;
-	value ^= (value << 15) & 0xDB8B0000;
-	value ^= (value >> 16);
-
-	return value;
+	return rand_temper(state32[state32[25]++]);
 }
 
 /*****************************************************************************
@@ -231,19 +273,55 @@ uint32_t rands(void *state) {
  * Using the given random number generator state, randomizes the first n bytes 
  * of the memory region pointed to by p. The probability of any bit being 1 in
  * that region is 1/2 and independent of all other bits.
+ *
+ * The aligned body of the region is filled a whole word at a time, straight
+ * from each regenerated block of state, instead of a byte per call.
  */
 
 void memrands(void *p, size_t n, void *state) {
-	uint8_t *byte = p;
-	uint32_t value = 0;
-	size_t i;
-	
-	for (i = 0; i < n; i++) {
-		if (i % 4 == 0) {
-			value = rands(state);
+	uint32_t *state32 = state;
+	uint8_t  *byte = p;
+	uint32_t *word;
+	uint32_t value;
+	size_t i, count;
+
+	if (!state) return;
+
+	/* unaligned head */
+	if ((uintptr_t) byte & 3) {
+		value = rands(state32);
+		while (n && ((uintptr_t) byte & 3)) {
+			*byte++ = value & 0xFF;
+			value >>= 8;
+			n--;
+		}
+	}
+
+	/* aligned words, one state block at a time */
+	word = (void*) byte;
+	while (n >= sizeof(uint32_t)) {
+		if (state32[25] >= 25) {
+			rand_regen(state32);
+			state32[25] = 0;
 		}
 
-		byte[i] = value & 0xFF;
-		value >>= 8;
+		count = 25 - state32[25];
+		if (count > n / sizeof(uint32_t)) {
+			count = n / sizeof(uint32_t);
+		}
+
+		for (i = 0; i < count; i++) {
+			word[i] = rand_temper(state32[state32[25] + i]);
+		}
+
+		state32[25] += count;
+		word += count;
+		n -= count * sizeof(uint32_t);
+	}
+
+	/* tail */
+	if (n) {
+		value = rands(state32);
+		memcpy(word, &value, n);
 	}
 }
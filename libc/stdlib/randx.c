@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2012 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * 
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <rho/mutex.h>
+#include <rho/proc.h>
+
+/****************************************************************************
+ * Cryptographic RNG for Rhombus
+ *
+ * randx() and memrandx() produce unpredictable output for things like 
+ * robject keys, where rand() would be trivially reproducible. Output is the
+ * ChaCha20 keystream under a 256-bit key; after every request the key is 
+ * replaced with fresh keystream, so a later compromise of the generator does
+ * not reveal earlier output.
+ *
+ * There is no hardware or kernel entropy source, so the key is stirred from 
+ * time stamp counter jitter across context switches, kernel and CPU time, 
+ * and process and thread IDs. The generator restirs whenever it notices it 
+ * is running in a new process, so a parent and its forked children never 
+ * share output.
+ */
+
+static uint32_t randx_key[8];
+static uint32_t randx_pid;
+static bool randx_mutex;
+
+/****************************************************************************
+ * randx_block
+ *
+ * Computes one 64-byte ChaCha20 block for the given key, counter, and nonce.
+ */
+
+#define ROTL(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+
+#define QROUND(a, b, c, d) do { \
+	a += b; d ^= a; d = ROTL(d, 16); \
+	c += d; b ^= c; b = ROTL(b, 12); \
+	a += b; d ^= a; d = ROTL(d, 8);  \
+	c += d; b ^= c; b = ROTL(b, 7);  \
+} while (0)
+
+static void randx_block(uint32_t *out, const uint32_t *key, uint64_t counter, uint64_t nonce) {
+	uint32_t in[16];
+	size_t i;
+
+	in[0]  = 0x61707865;
+	in[1]  = 0x3320646E;
+	in[2]  = 0x79622D32;
+	in[3]  = 0x6B206574;
+	for (i = 0; i < 8; i++) in[4 + i] = key[i];
+	in[12] = counter;
+	in[13] = counter >> 32;
+	in[14] = nonce;
+	in[15] = nonce >> 32;
+
+	for (i = 0; i < 16; i++) out[i] = in[i];
+
+	for (i = 0; i < 10; i++) {
+		QROUND(out[0], out[4], out[8],  out[12]);
+		QROUND(out[1], out[5], out[9],  out[13]);
+		QROUND(out[2], out[6], out[10], out[14]);
+		QROUND(out[3], out[7], out[11], out[15]);
+		QROUND(out[0], out[5], out[10], out[15]);
+		QROUND(out[1], out[6], out[11], out[12]);
+		QROUND(out[2], out[7], out[8],  out[13]);
+		QROUND(out[3], out[4], out[9],  out[14]);
+	}
+
+	for (i = 0; i < 16; i++) out[i] += in[i];
+}
+
+/****************************************************************************
+ * randx_stir
+ *
+ * Mixes fresh entropy into the generator key. Each key word is xor'ed with 
+ * a time stamp counter sample; yielding between samples lets scheduling 
+ * jitter into the low bits. The result is run through the block function 
+ * with the remaining inputs as the nonce, so none of them are recoverable 
+ * from the key.
+ */
+
+static void randx_stir(void) {
+	uint32_t block[16];
+	uint64_t tsc, nonce;
+	size_t i;
+
+	for (i = 0; i < 8; i++) {
+		tsc = __rdtsc();
+		randx_key[i] ^= (uint32_t) tsc ^ ROTL((uint32_t) (tsc >> 32), 16);
+		if (i & 1) sleep();
+	}
+
+	randx_pid = getpid();
+
+	nonce  = getktime() ^ (getctime() << 24);
+	nonce ^= (uint64_t) (randx_pid ^ (gettid() << 16)) << 32;
+	nonce ^= (uintptr_t) &nonce;
+
+	randx_block(block, randx_key, __rdtsc(), nonce);
+	memcpy(randx_key, block, sizeof(randx_key));
+	memclr(block, sizeof(block));
+}
+
+/****************************************************************************
+ * memrandx
+ *
+ * Fills the first n bytes of the memory region pointed to by p with 
+ * cryptographically strong random bytes.
+ */
+
+void memrandx(void *p, size_t n) {
+	uint32_t block[16];
+	uint8_t *byte = p;
+	uint64_t counter;
+	size_t size;
+
+	mutex_spin(&randx_mutex);
+
+	if (randx_pid != getpid()) {
+		randx_stir();
+	}
+
+	for (counter = 1; n; counter++) {
+		size = (n < sizeof(block)) ? n : sizeof(block);
+		randx_block(block, randx_key, counter, 0);
+		memcpy(byte, block, size);
+		byte += size;
+		n -= size;
+	}
+
+	/* rekey from block 0, which is never handed out */
+	randx_block(block, randx_key, 0, 0);
+	memcpy(randx_key, block, sizeof(randx_key));
+	memclr(block, sizeof(block));
+
+	mutex_free(&randx_mutex);
+}
+
+/****************************************************************************
+ * randx
+ *
+ * Returns a cryptographically strong random number in the range 0 to 
+ * RAND_MAX.
+ */
+
+uint32_t randx(void) {
+	uint32_t value;
+
+	memrandx(&value, sizeof(value));
+
+	return value;
+}
@@ -17,27 +17,80 @@
 #include <string.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <errno.h>
 
-#include <stdio.h>
+#include <rho/arch.h>
+
+#include "malloc.h"
 
 /****************************************************************************
  * realloc
  *
  * Changes the size of the allocated block at <ptr> to size <size>. Returns
- * the new value of <ptr> on success, NULL on failure.
+ * the new value of <ptr> on success, NULL on failure; on failure, the block
+ * at <ptr> is left untouched.
+ *
+ * Small blocks stay in place as long as the new size still fits their size
+ * class and does not waste more than half of it. Page runs are shrunk in
+ * place, grown in place if followed by free pages, and otherwise moved by
+ * remapping their pages if they are at least HEAP_REMAP pages long. Only
+ * when none of that is possible is a new block allocated and copied to.
  */
 
 void *realloc(void *ptr, size_t size) {
+	struct heap_page *page;
+	size_t old, pages;
 	void *new;
 
-	new = malloc(size);
+	if (!ptr) {
+		return malloc(size);
+	}
+
+	if (size > HEAP_SIZE) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	page = heap_page_get(ptr);
+	old  = msize(ptr);
+
+	if (page && page->type == HEAP_SLAB) {
+
+		if (size <= old && (size > old / 2 || old <= 32)) {
+			return ptr;
+		}
+	}
+	else if (page && page->type == HEAP_RUN && size > HEAP_SLAB_MAX) {
+		pages = (size + PAGESZ - 1) / PAGESZ;
+
+		if (!heap_page_resize(page, pages)) {
+			return ptr;
+		}
+
+		if (page->pages >= HEAP_REMAP) {
+			page = heap_page_move(page, pages);
 
-	size = (size > msize(ptr)) ? msize(ptr) : size;
+			if (page) {
+				new = heap_page_addr(page);
 
-	if (ptr) {
-		memcpy(new, ptr, size);
-		free(ptr);
+				if (mprof_period) {
+					mprof_free(ptr);
+					mprof_alloc(new, size, __builtin_return_address(0));
+				}
+
+				return new;
+			}
+		}
 	}
 
+	new = malloc(size);
+
+	if (!new) {
+		return NULL;
+	}
+
+	memcpy(new, ptr, (size > old) ? old : size);
+	free(ptr);
+
 	return new;
 }
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2012 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * 
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <string.h>
+#include <stdint.h>
+
+#define CPUID_FXSR	0x01000000	// FXSAVE/FXRSTOR (SSE state is preserved)
+#define CPUID_SSE2	0x04000000	// SSE2 instructions
+
+/****************************************************************************
+ * __string_sse2
+ *
+ * Nonzero if the SSE2 implementations of the memory and string functions
+ * may be used. Set once by __string_init() at startup.
+ */
+
+int __string_sse2 = 0;
+
+/****************************************************************************
+ * __string_init
+ *
+ * Selects the implementations of the memory and string functions based on
+ * the features reported by CPUID.
+ */
+
+void __string_init(void) {
+	uint32_t features;
+
+	features = __cpuid(1);
+
+	if ((features & CPUID_FXSR) && (features & CPUID_SSE2)) {
+		__string_sse2 = 1;
+	}
+}
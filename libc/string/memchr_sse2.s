@@ -0,0 +1,93 @@
+; Copyright (C) 2012 Nick Johnson <nickbjohnson4224 at gmail.com>
+; 
+; Permission to use, copy, modify, and distribute this software for any
+; purpose with or without fee is hereby granted, provided that the above
+; copyright notice and this permission notice appear in all copies.
+; 
+; THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+; WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+; MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+; ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+; WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+; ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+; OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+[bits 32]
+
+section .text
+
+; void *__memchr_sse2(const void *s, uint8_t c, size_t n)
+;
+; Scans the first <n> bytes of <s> for <c>, 16 bytes at a time. Only 
+; aligned blocks are loaded, so this never reads across a page boundary
+; that the buffer itself does not cross.
+
+global __memchr_sse2:function __memchr_sse2.end-__memchr_sse2
+
+__memchr_sse2:
+	push ebx
+
+	mov edx, [esp+8]
+	movzx eax, byte [esp+12]
+	mov ebx, [esp+16]
+
+	test ebx, ebx
+	jz .none
+
+	imul eax, eax, 0x01010101
+	movd xmm1, eax
+	pshufd xmm1, xmm1, 0
+
+	; first (partial) block
+	mov ecx, edx
+	and ecx, 15
+	and edx, -16
+	movdqa xmm0, [edx]
+	pcmpeqb xmm0, xmm1
+	pmovmskb eax, xmm0
+	shr eax, cl
+	neg ecx
+	add ecx, 16
+	test eax, eax
+	jz .next
+
+	bsf eax, eax
+	cmp eax, ebx
+	jae .none
+	add eax, edx
+	add eax, 16
+	sub eax, ecx
+	pop ebx
+	ret
+
+.next:
+	cmp ebx, ecx
+	jbe .none
+	sub ebx, ecx
+	add edx, 16
+
+.loop:
+	movdqa xmm0, [edx]
+	pcmpeqb xmm0, xmm1
+	pmovmskb eax, xmm0
+	test eax, eax
+	jnz .found
+	cmp ebx, 16
+	jbe .none
+	sub ebx, 16
+	add edx, 16
+	jmp .loop
+
+.found:
+	bsf eax, eax
+	cmp eax, ebx
+	jae .none
+	add eax, edx
+	pop ebx
+	ret
+
+.none:
+	xor eax, eax
+	pop ebx
+	ret
+.end:
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009, 2010 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2009-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -16,10 +16,20 @@
 
 #include <string.h>
 
+/****************************************************************************
+ * memclr
+ *
+ * Sets <n> bytes at <s> to zero. Returns <s>.
+ */
+
 void *memclr(void *s, size_t n) {
 	size_t i;
 	uint8_t *src = (uint8_t*) s;
 
+	if (__string_sse2) {
+		return __memset_sse2(s, 0, n);
+	}
+
 	for (i = 0; i < n; i++) {
 		src[i] = 0;
 	}
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009, 2010 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2009-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -17,11 +17,21 @@
 #include <string.h>
 #include <stdint.h>
 
+/****************************************************************************
+ * memcpy
+ *
+ * Copies <n> bytes from <s> to <d>, which may not overlap. Returns <d>.
+ */
+
 void *memcpy(void *d, const void *s, size_t n) {
 	size_t i;
 	uint8_t *dst = (uint8_t*) d;
 	uint8_t *src = (uint8_t*) s;
 
+	if (__string_sse2) {
+		return __memcpy_sse2(d, s, n);
+	}
+
 	for (i = 0; i < n; i++) {
 		dst[i] = src[i];
 	}
@@ -0,0 +1,91 @@
+; Copyright (C) 2012 Nick Johnson <nickbjohnson4224 at gmail.com>
+; 
+; Permission to use, copy, modify, and distribute this software for any
+; purpose with or without fee is hereby granted, provided that the above
+; copyright notice and this permission notice appear in all copies.
+; 
+; THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+; WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+; MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+; ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+; WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+; ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+; OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+[bits 32]
+
+section .text
+
+; void *__memcpy_sse2(void *d, const void *s, size_t n)
+;
+; Copies <n> bytes from <s> to <d>. The destination is aligned to 16 bytes
+; with a byte prologue, then copied in 64 and 16 byte blocks using 
+; unaligned loads and aligned stores, with a byte epilogue. Every block is
+; loaded before it is stored, so this is also safe for overlapping copies 
+; where <d> is below <s>.
+
+global __memcpy_sse2:function __memcpy_sse2.end-__memcpy_sse2
+
+__memcpy_sse2:
+	push edi
+	push esi
+
+	mov edi, [esp+12]
+	mov esi, [esp+16]
+	mov ecx, [esp+20]
+	mov eax, edi
+
+	cmp ecx, 32
+	jb .tail
+
+	; align destination
+	mov edx, edi
+	neg edx
+	and edx, 15
+	sub ecx, edx
+	xchg ecx, edx
+	rep movsb
+
+	; 64 byte blocks
+	mov ecx, edx
+	shr edx, 6
+	jz .block16
+
+.loop64:
+	movdqu xmm0, [esi]
+	movdqu xmm1, [esi+16]
+	movdqu xmm2, [esi+32]
+	movdqu xmm3, [esi+48]
+	movdqa [edi],    xmm0
+	movdqa [edi+16], xmm1
+	movdqa [edi+32], xmm2
+	movdqa [edi+48], xmm3
+	add esi, 64
+	add edi, 64
+	dec edx
+	jnz .loop64
+
+	; 16 byte blocks
+.block16:
+	and ecx, 63
+	mov edx, ecx
+	shr edx, 4
+	jz .tail
+
+.loop16:
+	movdqu xmm0, [esi]
+	movdqa [edi], xmm0
+	add esi, 16
+	add edi, 16
+	dec edx
+	jnz .loop16
+
+	and ecx, 15
+
+.tail:
+	rep movsb
+
+	pop esi
+	pop edi
+	ret
+.end:
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009, 2010 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2009-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -16,11 +16,25 @@
 
 #include <string.h>
 
+/****************************************************************************
+ * memmove
+ *
+ * Copies <n> bytes from <s> to <d>, which may overlap. Returns <d>.
+ */
+
 void *memmove(void *d, const void *s, size_t n) {
 	size_t i;
 	uint8_t *dst = (uint8_t*) d;
 	uint8_t *src = (uint8_t*) s;
 
+	if (__string_sse2) {
+		if ((uintptr_t) dst - (uintptr_t) src >= n) {
+			/* forward copy is safe unless <d> overlaps the end of <s> */
+			return __memcpy_sse2(d, s, n);
+		}
+		return __memrcpy_sse2(d, s, n);
+	}
+
 	if (src == dst) {
 		return dst;
 	}
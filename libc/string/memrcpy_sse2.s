@@ -0,0 +1,102 @@
+; Copyright (C) 2012 Nick Johnson <nickbjohnson4224 at gmail.com>
+; 
+; Permission to use, copy, modify, and distribute this software for any
+; purpose with or without fee is hereby granted, provided that the above
+; copyright notice and this permission notice appear in all copies.
+; 
+; THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+; WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+; MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+; ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+; WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+; ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+; OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+[bits 32]
+
+section .text
+
+; void *__memrcpy_sse2(void *d, const void *s, size_t n)
+;
+; Copies <n> bytes from <s> to <d> backward, starting at the end. The end
+; of the destination is aligned to 16 bytes with a byte prologue, then it
+; is copied in 64 and 16 byte blocks. Every block is loaded before it is 
+; stored, so this is safe for overlapping copies where <d> is above <s>.
+
+global __memrcpy_sse2:function __memrcpy_sse2.end-__memrcpy_sse2
+
+__memrcpy_sse2:
+	push edi
+	push esi
+
+	mov edi, [esp+12]
+	mov esi, [esp+16]
+	mov ecx, [esp+20]
+	mov eax, edi
+
+	lea edi, [edi+ecx]
+	lea esi, [esi+ecx]
+
+	cmp ecx, 32
+	jb .tail
+
+	; align end of destination
+	mov edx, edi
+	and edx, 15
+	sub ecx, edx
+	xchg ecx, edx
+	dec edi
+	dec esi
+	std
+	rep movsb
+	cld
+	inc edi
+	inc esi
+
+	; 64 byte blocks
+	mov ecx, edx
+	shr edx, 6
+	jz .block16
+
+.loop64:
+	sub esi, 64
+	sub edi, 64
+	movdqu xmm0, [esi+48]
+	movdqu xmm1, [esi+32]
+	movdqu xmm2, [esi+16]
+	movdqu xmm3, [esi]
+	movdqa [edi+48], xmm0
+	movdqa [edi+32], xmm1
+	movdqa [edi+16], xmm2
+	movdqa [edi],    xmm3
+	dec edx
+	jnz .loop64
+
+	; 16 byte blocks
+.block16:
+	and ecx, 63
+	mov edx, ecx
+	shr edx, 4
+	jz .tail
+
+.loop16:
+	sub esi, 16
+	sub edi, 16
+	movdqu xmm0, [esi]
+	movdqa [edi], xmm0
+	dec edx
+	jnz .loop16
+
+	and ecx, 15
+
+.tail:
+	dec edi
+	dec esi
+	std
+	rep movsb
+	cld
+
+	pop esi
+	pop edi
+	ret
+.end:
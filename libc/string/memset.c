@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009, 2010 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2009-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -17,10 +17,20 @@
 #include <string.h>
 #include <stdint.h>
 
+/****************************************************************************
+ * memset
+ *
+ * Sets <n> bytes at <s> to <c>. Returns <s>.
+ */
+
 void *memset(void *s, uint8_t c, size_t n) {
 	size_t i;
 	uint8_t *src = (uint8_t*) s;
 
+	if (__string_sse2) {
+		return __memset_sse2(s, c, n);
+	}
+
 	for (i = 0; i < n; i++) {
 		src[i] = c;
 	}
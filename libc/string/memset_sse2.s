@@ -0,0 +1,84 @@
+; Copyright (C) 2012 Nick Johnson <nickbjohnson4224 at gmail.com>
+; 
+; Permission to use, copy, modify, and distribute this software for any
+; purpose with or without fee is hereby granted, provided that the above
+; copyright notice and this permission notice appear in all copies.
+; 
+; THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+; WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+; MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+; ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+; WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+; ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+; OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+[bits 32]
+
+section .text
+
+; void *__memset_sse2(void *s, uint8_t c, size_t n)
+;
+; Sets <n> bytes at <s> to <c>. The destination is aligned to 16 bytes
+; with a byte prologue, then filled in 64 and 16 byte blocks, with a byte
+; epilogue.
+
+global __memset_sse2:function __memset_sse2.end-__memset_sse2
+
+__memset_sse2:
+	push edi
+
+	mov edi, [esp+8]
+	movzx eax, byte [esp+12]
+	mov ecx, [esp+16]
+
+	cmp ecx, 32
+	jb .tail
+
+	imul eax, eax, 0x01010101
+	movd xmm0, eax
+	pshufd xmm0, xmm0, 0
+
+	; align destination
+	mov edx, edi
+	neg edx
+	and edx, 15
+	sub ecx, edx
+	xchg ecx, edx
+	rep stosb
+
+	; 64 byte blocks
+	mov ecx, edx
+	shr edx, 6
+	jz .block16
+
+.loop64:
+	movdqa [edi],    xmm0
+	movdqa [edi+16], xmm0
+	movdqa [edi+32], xmm0
+	movdqa [edi+48], xmm0
+	add edi, 64
+	dec edx
+	jnz .loop64
+
+	; 16 byte blocks
+.block16:
+	and ecx, 63
+	mov edx, ecx
+	shr edx, 4
+	jz .tail
+
+.loop16:
+	movdqa [edi], xmm0
+	add edi, 16
+	dec edx
+	jnz .loop16
+
+	and ecx, 15
+
+.tail:
+	rep stosb
+
+	mov eax, [esp+8]
+	pop edi
+	ret
+.end:
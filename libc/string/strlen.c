@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009, 2010 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2009-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -17,9 +17,19 @@
 #include <stdint.h>
 #include <string.h>
 
+/****************************************************************************
+ * strlen
+ *
+ * Returns the length of the string <s>, not including the null terminator.
+ */
+
 size_t strlen(const char *s) {
 	size_t i;
 
+	if (__string_sse2) {
+		return __strlen_sse2(s);
+	}
+
 	for (i = 0; s[i]; i++);
 
 	return i;
@@ -0,0 +1,57 @@
+; Copyright (C) 2012 Nick Johnson <nickbjohnson4224 at gmail.com>
+; 
+; Permission to use, copy, modify, and distribute this software for any
+; purpose with or without fee is hereby granted, provided that the above
+; copyright notice and this permission notice appear in all copies.
+; 
+; THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+; WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+; MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+; ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+; WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+; ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+; OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+[bits 32]
+
+section .text
+
+; size_t __strlen_sse2(const char *s)
+;
+; Finds the length of <s>, 16 bytes at a time. Only aligned blocks are 
+; loaded, so this never reads across a page boundary that the string 
+; itself does not cross.
+
+global __strlen_sse2:function __strlen_sse2.end-__strlen_sse2
+
+__strlen_sse2:
+	mov edx, [esp+4]
+	pxor xmm1, xmm1
+
+	; first (partial) block
+	mov ecx, edx
+	and ecx, 15
+	and edx, -16
+	movdqa xmm0, [edx]
+	pcmpeqb xmm0, xmm1
+	pmovmskb eax, xmm0
+	shr eax, cl
+	test eax, eax
+	jz .loop
+
+	bsf eax, eax
+	ret
+
+.loop:
+	add edx, 16
+	movdqa xmm0, [edx]
+	pcmpeqb xmm0, xmm1
+	pmovmskb eax, xmm0
+	test eax, eax
+	jz .loop
+
+	bsf eax, eax
+	add eax, edx
+	sub eax, [esp+4]
+	ret
+.end:
@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2012 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * 
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rho/struct.h>
+#include <rho/mutex.h>
+
+/*
+ * Atoms are interned strings: each distinct string is assigned a small
+ * nonzero integer once, so it can be used as an s_map key and compared by
+ * value. Atoms are never freed. The string index is an open-addressing 
+ * table of atoms that stores each string's hash and name next to it.
+ *
+ * Lookups take no lock, since they happen on every request. Writers 
+ * serialize on _atom_mutex, fill in a slot's hash last, and grow the index
+ * and the name array by copying and then publishing the copy. Replaced 
+ * copies are never freed (readers may still be using them); like atoms 
+ * themselves, they add up to less than the current ones.
+ */
+
+struct atom_slot {
+	uint32_t hash; // 0 if empty; written last
+	uint32_t atom;
+	const char *name;
+};
+
+struct atom_index {
+	volatile uint32_t size; // slots (power of two)
+	volatile struct atom_slot slot[];
+};
+
+static bool                        _atom_mutex;
+static const char *volatile       *volatile _atom_name; // indexed by atom
+static volatile uint32_t           _atom_count; // atoms allocated, including 0
+static uint32_t                    _atom_limit; // size of _atom_name
+static struct atom_index *volatile _atom_index;
+
+static uint32_t _hash(const char *string) {
+	const uint8_t *s = (const uint8_t*) string;
+	uint32_t hash = 2166136261U;
+
+	/* FNV-1a */
+	while (*s) {
+		hash ^= *s++;
+		hash *= 16777619;
+	}
+
+	return hash | 1;
+}
+
+static volatile struct atom_slot *_find(struct atom_index *index, const char *string, uint32_t hash) {
+	volatile struct atom_slot *slot;
+	uint32_t i, mask, slot_hash;
+
+	if (!index) {
+		return NULL;
+	}
+
+	mask = index->size - 1;
+
+	for (i = hash & mask;; i = (i + 1) & mask) {
+		slot = &index->slot[i];
+		slot_hash = slot->hash;
+
+		if (!slot_hash) {
+			return slot;
+		}
+
+		if (slot_hash == hash && !strcmp(slot->name, string)) {
+			return slot;
+		}
+	}
+}
+
+static int _grow(void) {
+	struct atom_index *index, *old_index;
+	const char *volatile *name;
+	uint32_t size, i, j;
+
+	/* grow name array */
+	if (_atom_count >= _atom_limit) {
+		size = (_atom_limit) ? _atom_limit * 2 : 64;
+		name = malloc(sizeof(char*) * size);
+		if (!name) return 1;
+		for (i = 0; i < _atom_limit && i < _atom_count; i++) name[i] = _atom_name[i];
+		_atom_name  = name;
+		_atom_limit = size;
+	}
+
+	/* grow index, keeping load under 50% */
+	old_index = _atom_index;
+	if (!old_index || _atom_count * 2 >= old_index->size) {
+		size = (old_index) ? old_index->size * 2 : 128;
+		index = calloc(sizeof(struct atom_index) + sizeof(struct atom_slot) * size, 1);
+		if (!index) return 1;
+		index->size = size;
+
+		for (i = 0; old_index && i < old_index->size; i++) {
+			if (old_index->slot[i].hash) {
+				for (j = old_index->slot[i].hash & (size - 1); index->slot[j].hash; j = (j + 1) & (size - 1));
+				index->slot[j].atom = old_index->slot[i].atom;
+				index->slot[j].name = old_index->slot[i].name;
+				index->slot[j].hash = old_index->slot[i].hash;
+			}
+		}
+
+		_atom_index = index;
+	}
+
+	return 0;
+}
+
+/*****************************************************************************
+ * s_atom
+ *
+ * Returns the atom for <string>, creating it if it does not exist. Returns
+ * zero on error.
+ */
+
+uint32_t s_atom(const char *string) {
+	volatile struct atom_slot *slot;
+	uint32_t hash, atom;
+	char *copy;
+
+	if (!string) {
+		return 0;
+	}
+
+	hash = _hash(string);
+
+	mutex_spin(&_atom_mutex);
+
+	slot = _find(_atom_index, string, hash);
+	if (slot && slot->hash) {
+		atom = slot->atom;
+		mutex_free(&_atom_mutex);
+		return atom;
+	}
+
+	if (!_atom_count) {
+		_atom_count = 1; // atom 0 is never allocated
+	}
+
+	copy = strdup(string);
+	if (!copy || _grow()) {
+		mutex_free(&_atom_mutex);
+		free(copy);
+		return 0;
+	}
+
+	atom = _atom_count;
+	_atom_name[atom] = copy;
+	_atom_count = atom + 1;
+
+	slot = _find(_atom_index, string, hash);
+	slot->atom = atom;
+	slot->name = copy;
+	slot->hash = hash;
+
+	mutex_free(&_atom_mutex);
+
+	return atom;
+}
+
+/*****************************************************************************
+ * s_atom_find
+ *
+ * Returns the atom for <string>, or zero if there is none. A string that 
+ * has no atom cannot be the key of anything, so lookups use this instead of
+ * s_atom() to avoid interning every string they are asked about. Takes no 
+ * lock.
+ */
+
+uint32_t s_atom_find(const char *string) {
+	volatile struct atom_slot *slot;
+
+	if (!string) {
+		return 0;
+	}
+
+	slot = _find(_atom_index, string, _hash(string));
+
+	return (slot && slot->hash) ? slot->atom : 0;
+}
+
+/*****************************************************************************
+ * s_atom_name
+ *
+ * Returns the string for <atom>, or null if <atom> is not an atom. Takes no
+ * lock.
+ */
+
+const char *s_atom_name(uint32_t atom) {
+	uint32_t count;
+
+	// the name array is published before the count that covers it
+	count = _atom_count;
+
+	if (atom && atom < count) {
+		return _atom_name[atom];
+	}
+
+	return NULL;
+}
@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2012 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * 
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rho/struct.h>
+
+#define MAP_MINSIZE 4 // smallest table is (1 << 4) slots
+
+/*
+ * Open-addressing table with linear probing. Every occupied slot stores 
+ * the hash of its key, which is never zero, so empty slots are recognized
+ * without touching the key, and entries can be moved without rehashing.
+ * Deletion shifts the rest of the probe run back instead of leaving
+ * tombstones.
+ */
+
+static uint32_t _hash(uint32_t key) {
+
+	/* murmur3 finalizer */
+	key ^= key >> 16;
+	key *= 0x85EBCA6B;
+	key ^= key >> 13;
+	key *= 0xC2B2AE35;
+	key ^= key >> 16;
+
+	return key | 1;
+}
+
+static struct s_map *_cons(size_t size) {
+	struct s_map *map;
+
+	map = calloc(sizeof(struct s_map) + (sizeof(struct s_map_entry) << size), 1);
+	if (!map) return NULL;
+	map->size = size;
+
+	return map;
+}
+
+static struct s_map_entry *_find(struct s_map *map, uint32_t key, uint32_t hash) {
+	struct s_map_entry *entry;
+	uint32_t mask = (1 << map->size) - 1;
+	uint32_t i;
+
+	for (i = hash & mask;; i = (i + 1) & mask) {
+		entry = &map->table[i];
+
+		if (!entry->hash || (entry->hash == hash && entry->key == key)) {
+			return entry;
+		}
+	}
+}
+
+static struct s_map *_resize(struct s_map *map, size_t size) {
+	struct s_map *new_map;
+	struct s_map_entry *entry;
+	size_t i;
+
+	new_map = _cons(size);
+	if (!new_map) return map;
+
+	for (i = 0; i < (1U << map->size); i++) {
+		if (map->table[i].hash) {
+			entry = _find(new_map, map->table[i].key, map->table[i].hash);
+			*entry = map->table[i];
+		}
+	}
+
+	new_map->load = map->load;
+	free(map);
+
+	return new_map;
+}
+
+static void _del(struct s_map *map, struct s_map_entry *entry) {
+	uint32_t mask = (1 << map->size) - 1;
+	uint32_t i, j, k;
+
+	i = entry - map->table;
+
+	for (j = (i + 1) & mask; map->table[j].hash; j = (j + 1) & mask) {
+		k = map->table[j].hash & mask;
+
+		/* move back entries whose home slot is not in (i, j] */
+		if ((i < j) ? (k <= i || k > j) : (k <= i && k > j)) {
+			map->table[i] = map->table[j];
+			i = j;
+		}
+	}
+
+	map->table[i].hash = 0;
+	map->table[i].data = NULL;
+	map->load--;
+}
+
+/*
+ * Interface
+ */
+
+struct s_map *s_map_set(struct s_map *map, uint32_t key, void *data) {
+	struct s_map_entry *entry;
+	uint32_t hash = _hash(key);
+
+	if (!map) {
+		if (!data) return NULL;
+		map = _cons(MAP_MINSIZE);
+		if (!map) return NULL;
+	}
+
+	entry = _find(map, key, hash);
+
+	if (data) {
+		if (!entry->hash) {
+			if (map->load + 2 > (1U << map->size)) {
+				// table is full and could not be grown
+				return map;
+			}
+			entry->hash = hash;
+			entry->key  = key;
+			map->load++;
+		}
+		entry->data = data;
+
+		if (map->load * 4 > (3U << map->size)) {
+			// load exceeds 75% - double size
+			map = _resize(map, map->size + 1);
+		}
+	}
+	else if (entry->hash) {
+		_del(map, entry);
+
+		if (map->size > MAP_MINSIZE && map->load < (1U << map->size) >> 3) {
+			// load is less than 12.5% - halve size
+			map = _resize(map, map->size - 1);
+		}
+	}
+
+	return map;
+}
+
+void *s_map_get(struct s_map *map, uint32_t key) {
+
+	if (!map) {
+		return NULL;
+	}
+
+	return _find(map, key, _hash(key))->data;
+}
+
+struct s_map *s_map_setp(struct s_map *map, const void *key, void *data) {
+	return s_map_set(map, (uintptr_t) key, data);
+}
+
+void *s_map_getp(struct s_map *map, const void *key) {
+	return s_map_get(map, (uintptr_t) key);
+}
+
+void s_map_free(struct s_map *map) {
+	free(map);
+}
+
+void s_map_iter(struct s_map *map, void *arg0, void (*iter)(void *, uint32_t, void *)) {
+	size_t i;
+
+	if (!map) {
+		return;
+	}
+
+	for (i = 0; i < (1U << map->size); i++) {
+		if (map->table[i].hash) {
+			iter(arg0, map->table[i].key, map->table[i].data);
+		}
+	}
+}
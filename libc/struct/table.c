@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2011-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -233,11 +233,10 @@ static void _iter(struct s_table *table, void *arg0, void (*func)(void *, const
 	}
 }
 
-static char *_itostring(uint32_t x) {
-	uint8_t *string;
+static char *_itostring(char *buffer, uint32_t x) {
+	uint8_t *string = (uint8_t*) buffer;
 	size_t i;
 
-	string = malloc(6);
 	string[5] = 0;
 	string[4] = 0;
 
@@ -254,7 +253,7 @@ static char *_itostring(uint32_t x) {
 		}
 	}
 
-	return (char*) string;
+	return buffer;
 }
 
 /*
@@ -301,12 +300,26 @@ void *s_table_get(struct s_table *table, const char *field) {
 }
 
 void s_table_free(struct s_table *table) {
-	_free(table);
+	if (table) _free(table);
 }
 
 struct s_table *s_table_setv(struct s_table *table, void *data, const char *field, ...) {
+	char buffer[64];
 	char *_field;
 	va_list ap;
+	int length;
+
+	va_start(ap, field);
+	length = vsnprintf(buffer, sizeof(buffer), field, ap);
+	va_end(ap);
+
+	if (length < 0) {
+		return table;
+	}
+
+	if ((size_t) length < sizeof(buffer)) {
+		return s_table_set(table, buffer, data);
+	}
 
 	va_start(ap, field);
 	_field = vsaprintf(field, ap);
@@ -324,9 +337,23 @@ struct s_table *s_table_setv(struct s_table *table, void *data, const char *fiel
 }
 
 void *s_table_getv(struct s_table *table, const char *field, ...) {
+	char buffer[64];
 	char *_field;
 	void *data;
 	va_list ap;
+	int length;
+
+	va_start(ap, field);
+	length = vsnprintf(buffer, sizeof(buffer), field, ap);
+	va_end(ap);
+
+	if (length < 0) {
+		return NULL;
+	}
+
+	if ((size_t) length < sizeof(buffer)) {
+		return s_table_get(table, buffer);
+	}
 
 	va_start(ap, field);
 	_field = vsaprintf(field, ap);
@@ -348,22 +375,13 @@ void s_table_iter(struct s_table *table, void *arg0, void (*iter)(void *, const
 }
 
 struct s_table *s_table_seti(struct s_table *table, uint32_t field, void *data) {
-	char *_field;
-
-	_field = _itostring(field);
-	table = s_table_set(table, _field, data);
-	free(_field);
+	char _field[6];
 
-	return table;
+	return s_table_set(table, _itostring(_field, field), data);
 }
 
 void *s_table_geti(struct s_table *table, uint32_t field) {
-	char *_field;
-	void *data;
+	char _field[6];
 
-	_field = _itostring(field);
-	data = s_table_get(table, _field);
-	free(_field);
-
-	return data;
+	return s_table_get(table, _itostring(_field, field));
 }
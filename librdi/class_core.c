@@ -33,7 +33,7 @@ static char *__type(struct robject *self, rp_t src, int argc, char **argv) {
 	char *parent_type;
 	char *final_type;
 
-	type = robject_data(self, "type");	
+	type = self->type;
 	parent_type = robject_call(self->parent, src, 0, "type");
 
 	if (parent_type) {
@@ -153,18 +153,18 @@ static char *_get_key(struct robject *r, rp_t src, int argc, char **argv) {
 }
 static char *_listen(struct robject *r, rp_t src, int argc, char **argv) {
 
-	mutex_spin(&r->mutex);
+	rwlock_wspin(&r->lock);
 	r->subs_table = s_table_setv(r->subs_table, (void*) 1, "%d", RP_PID(src));
-	mutex_free(&r->mutex);
+	rwlock_wfree(&r->lock);
 
 	return strdup("T");
 }
 
 static char *_un_listen(struct robject *r, rp_t src, int argc, char **argv) {
 	
-	mutex_spin(&r->mutex);
+	rwlock_wspin(&r->lock);
 	r->subs_table = s_table_setv(r->subs_table, (void*) 0, "%d", RP_PID(src));
-	mutex_free(&r->mutex);
+	rwlock_wfree(&r->lock);
 
 	return strdup("T");
 }
@@ -238,6 +238,32 @@ static void __rcall_handler(struct msg *msg) {
 	msend(reply);
 }
 
+static void __brcall_handler(struct msg *msg) {
+	struct brcall_arg argv[BRCALL_MAXARG];
+	char sig[BRCALL_MAXARG + 1];
+	struct robject *ro;
+	uint32_t method;
+	int32_t ret;
+
+	ro = robject_get(RP_INDEX(msg->target));
+
+	if (!ro || RP_INDEX(msg->target) == 0) {
+		ret = -ENOSYS;
+	}
+	else if (brcall_unpack(msg, &method, sig, argv) < 0) {
+		ret = -EINVAL;
+	}
+	else {
+		ret = robject_brcall(ro, msg->source, msg->key, method, sig, argv);
+	}
+
+	// reply in place; the request payload is no longer needed
+	*(int32_t*) msg->data = ret;
+	msg->length = sizeof(int32_t);
+	msg->key    = 0;
+	mreply(msg);
+}
+
 struct robject *rdi_class_core;
 
 void __rdi_class_core_setup(void) {
@@ -245,7 +271,7 @@ void __rdi_class_core_setup(void) {
 	// create core class
 	rdi_class_core = robject_cons(0, NULL);
 
-	robject_set_data(rdi_class_core, "type", (void*) "event basic");
+	robject_set_type(rdi_class_core, "event basic");
 	robject_set_data(rdi_class_core, "name", (void*) "RDI-class-core");
 
 	robject_set_call(rdi_class_core, "type", __type, AC_NULL);
@@ -259,7 +285,8 @@ void __rdi_class_core_setup(void) {
 	robject_set_call(rdi_class_core, "un-listen", _un_listen, AC_EVENT);
 
 	// set rcall and close handlers
-	when(ACTION_RCALL, __rcall_handler);
+	rdi_when(ACTION_RCALL, __rcall_handler);
+	rdi_when(ACTION_BRCALL, __brcall_handler);
 
 	// set constructor
 	rcall_hook("cons", _cons);
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2011-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -19,26 +19,214 @@
 #include <stdio.h>
 #include <errno.h>
 
+#include <rho/mutex.h>
+#include <rho/natio.h>
 #include <rho/proc.h>
 
 #include <rdi/robject.h>
 #include <rdi/core.h>
 #include <rdi/vfs.h>
 
-struct __dirent_list {
-	struct __dirent_list *next;
-	struct __dirent_list *prev;
+/*
+ * Directory entry index.
+ *
+ * Each directory keeps its entries in a compact array, in the order they 
+ * were linked (except that unlinking moves the last entry into the hole), 
+ * plus an open-addressed hash table of array positions keyed by name. 
+ * Lookup, link and unlink are O(1) and listing is a single pass over the 
+ * array (listx pages through it in name order, so that a listing can 
+ * resume by name). The index lives in the directory's private area (see 
+ * rdi_dir_cons) and is protected by its own reader/writer lock.
+ */
+
+struct __dirent {
+	uint32_t hash;
 	char *name;
+	struct robject *ro;
+};
+
+struct __dir {
+	uint32_t lock;
+
+	struct __dirent *entry;
+	uint32_t count;
+	uint32_t capacity;
+
+	uint32_t *table; // entry position + 1, or 0 if empty
+	uint32_t  mask;  // table size - 1, or 0 if there is no table
 };
 
-static struct robject *__find(struct robject *root, const char *path_str, const char **tail) {
+#define DIR_MINSIZE 8
+
+static uint32_t _hash(const char *name) {
+	uint32_t hash = 0x811C9DC5;
+
+	while (*name) {
+		hash ^= (uint8_t) *name++;
+		hash *= 0x01000193;
+	}
+
+	return hash;
+}
+
+static struct __dir *_dir(struct robject *r) {
+	struct robject *class;
+
+	// only objects constructed by rdi_dir_cons carry a directory index
+	if (!r || r->priv_size != sizeof(struct __dir)) {
+		return NULL;
+	}
+
+	for (class = r->parent; class; class = class->parent) {
+		if (class == rdi_class_dir) {
+			return r->priv;
+		}
+	}
+
+	return NULL;
+}
+
+// returns the table slot holding <name>, or the empty slot where it belongs
+static uint32_t _slot(struct __dir *dir, const char *name, uint32_t hash) {
+	struct __dirent *entry;
+	uint32_t i;
+
+	for (i = hash & dir->mask; dir->table[i]; i = (i + 1) & dir->mask) {
+		entry = &dir->entry[dir->table[i] - 1];
+
+		if (entry->hash == hash && !strcmp(entry->name, name)) {
+			break;
+		}
+	}
+
+	return i;
+}
+
+static int _resize(struct __dir *dir, uint32_t size) {
+	uint32_t *table;
+	uint32_t i, j;
+
+	table = calloc(size, sizeof(uint32_t));
+	if (!table) return 1;
+
+	free(dir->table);
+	dir->table = table;
+	dir->mask  = size - 1;
+
+	for (i = 0; i < dir->count; i++) {
+		for (j = dir->entry[i].hash & dir->mask; table[j]; j = (j + 1) & dir->mask);
+		table[j] = i + 1;
+	}
+
+	return 0;
+}
+
+static struct robject *_dir_get(struct __dir *dir, const char *name) {
+	uint32_t i;
+
+	if (!dir->count) return NULL;
+
+	i = _slot(dir, name, _hash(name));
+
+	return (dir->table[i]) ? dir->entry[dir->table[i] - 1].ro : NULL;
+}
+
+static int _dir_set(struct __dir *dir, const char *name, struct robject *ro) {
+	struct __dirent *entry;
+	uint32_t capacity;
+	uint32_t hash, i;
+
+	hash = _hash(name);
+
+	if (dir->count) {
+		i = _slot(dir, name, hash);
+
+		if (dir->table[i]) {
+			// entry already exists; only change hardlink
+			dir->entry[dir->table[i] - 1].ro = ro;
+			return 0;
+		}
+	}
+
+	// keep the table at most 3/4 full
+	if ((dir->count + 1) * 4 > (dir->mask + 1) * 3 || !dir->table) {
+		if (_resize(dir, (dir->table) ? (dir->mask + 1) * 2 : DIR_MINSIZE)) {
+			return 1;
+		}
+	}
+
+	if (dir->count == dir->capacity) {
+		capacity = (dir->capacity) ? dir->capacity * 2 : DIR_MINSIZE;
+		entry = realloc(dir->entry, sizeof(struct __dirent) * capacity);
+		if (!entry) return 1;
+
+		dir->entry = entry;
+		dir->capacity = capacity;
+	}
+
+	entry = &dir->entry[dir->count];
+	entry->hash = hash;
+	entry->name = strdup(name);
+	entry->ro   = ro;
+
+	if (!entry->name) return 1;
+
+	dir->count++;
+	dir->table[_slot(dir, name, hash)] = dir->count;
+
+	return 0;
+}
+
+static int _dir_del(struct __dir *dir, const char *name) {
+	struct __dirent *last;
+	uint32_t i, j, k, pos;
+
+	if (!dir->count) return 1;
+
+	i = _slot(dir, name, _hash(name));
+	if (!dir->table[i]) return 1;
+
+	pos = dir->table[i] - 1;
+	free(dir->entry[pos].name);
+
+	// backward-shift deletion keeps probe chains unbroken without tombstones
+	for (j = (i + 1) & dir->mask; dir->table[j]; j = (j + 1) & dir->mask) {
+		k = dir->entry[dir->table[j] - 1].hash & dir->mask;
+
+		if ((j > i && (k <= i || k > j)) || (j < i && (k <= i && k > j))) {
+			dir->table[i] = dir->table[j];
+			i = j;
+		}
+	}
+	dir->table[i] = 0;
+
+	// fill the hole in the entry array with the last entry
+	dir->count--;
+	if (pos != dir->count) {
+		last = &dir->entry[dir->count];
+		dir->table[_slot(dir, last->name, last->hash)] = pos + 1;
+		dir->entry[pos] = *last;
+	}
+
+	return 0;
+}
+
+/*
+ * Walks <path_str> from <root>, stopping at the first link. If <src> is not
+ * zero, it is registered for change notifications on every object visited,
+ * because the result (which <src> may cache) depends on all of them.
+ */
+
+static struct robject *__find(struct robject *root, const char *path_str, const char **tail, rp_t src) {
+	struct __dir *dir;
 	struct path *path;
 	char *name;
-	char *lookup;
 
 	path = path_cons(path_str);
 
 	while (root) {
+		if (src) robject_watch(root, src);
+
 		name = path_next(path);
 
 		if (!name) {
@@ -48,49 +236,120 @@ static struct robject *__find(struct robject *root, const char *path_str, const
 		}
 
 		if (robject_check_type(root, "link")) {
+			free(name);
 			path_prev(path);
 			if (tail) *tail = path_tail(path);
 			free(path);
 			return root;
 		}
 
-		lookup = strvcat("dirent-", name, NULL);
-		root = robject_data(root, lookup);
-		free(lookup);
+		dir = _dir(root);
+		if (!dir) {
+			free(name);
+			break;
+		}
+
+		rwlock_rspin(&dir->lock);
+		root = _dir_get(dir, name);
+		rwlock_rfree(&dir->lock);
+
+		free(name);
 	}
 
+	free(path);
 	return NULL;
 }
 
+/*
+ * Follows the redirect <reply> to a link rooted at a resource pointer by
+ * asking the driver it points to for the rest of the path. Returns <reply>
+ * and that driver's answer, one per line; if the answer is another 
+ * redirect, the caller has to follow it itself. Only links the driver 
+ * trusts (see rdi_class_link) are followed this way, because the handler
+ * blocks until the target replies: a link made by anyone could point at a
+ * process that never does, and tie up the driver's threads.
+ */
+
+static char *_forward(rp_t src, char *reply, bool link) {
+	struct robject *ro;
+	char *chain, *next, *path, *args;
+	rp_t root;
+
+	if (strncmp(reply, ">> @", 4)) {
+		return reply;
+	}
+
+	// split the link target into root and path, as fs_find would
+	root = ator(&reply[3]);
+	for (path = &reply[3]; *path && *path != '/'; path++);
+	path = (*path) ? path_simplify(path) : strdup("/");
+	if (!path) return reply;
+
+	if (!strcmp(path, "/")) {
+		next = rtoa(root);
+	}
+	else if (RP_PID(root) == getpid()) {
+		// don't rcall ourselves; we may be out of threads to answer
+		ro = robject_get(RP_INDEX(root));
+		args = saprintf((link) ? "find -L %s" : "find %s", path);
+		next = (ro && args) ? robject_call(ro, src, 0, args) : errorstr(ENOENT);
+		free(args);
+	}
+	else {
+		next = rcall(root, 0, (link) ? "find -L %s" : "find %s", path);
+	}
+
+	free(path);
+	if (!next) return reply;
+
+	chain = saprintf("%s\n%s", reply, next);
+	free(next);
+
+	if (!chain) return reply;
+
+	free(reply);
+	return chain;
+}
+
 static char *_find(struct robject *r, rp_t src, int argc, char **argv) {
 	struct robject *file;
 	const char *path;
 	const char *tail;
+	char *reply;
 	bool link;
+	bool forward;
+	int i;
 
-	if (argc <= 1) rtoa(RP_CONS(getpid(), r->index));
+	if (argc <= 1) return rtoa(RP_CONS(getpid(), r->index));
 
-	// check for link follow flag
-	if (argc == 2) {
-		link = false;
-		path = argv[1];
-	}
-	else if (!strcmp(argv[1], "-L")) {
-		link = true;
-		path = argv[2];
-	}
-	else {
-		return strdup("! arg");
+	// check for link follow and forwarding flags
+	link = false;
+	forward = false;
+	for (i = 1; i < argc - 1; i++) {
+		if (!strcmp(argv[i], "-L")) {
+			link = true;
+		}
+		else if (!strcmp(argv[i], "-r")) {
+			forward = true;
+		}
+		else {
+			return strdup("! arg");
+		}
 	}
+	path = argv[argc - 1];
 
 	// find resource
-	file = __find(r, path, &tail);
+	file = __find(r, path, &tail, src);
 
 	if (!file) return errorstr(ENOENT);
 
 	if (robject_check_type(file, "link") && !(!tail && link)) {
 		/* return redirect to symlink */
-		return saprintf(">> %s/%s", robject_data(file, "link"), (tail) ? tail : "");
+		reply = saprintf(">> %s/%s", robject_data(file, "link"), (tail) ? tail : "");
+		if (forward && reply && robject_data(file, "link-trusted")) {
+			reply = _forward(src, reply, link);
+		}
+		return reply;
 	}
 	else {
 		/* return resource pointer */
@@ -99,43 +358,204 @@ static char *_find(struct robject *r, rp_t src, int argc, char **argv) {
 }
 
 static char *_list(struct robject *r, rp_t src, int argc, char **argv) {
-	struct __dirent_list *node;
-	char *list;
-	char *temp;
-
-	list = NULL;
-	node = robject_data(r, "list");
-
-	while (node) {
-		if (list) {
-			temp = list;
-			list = strvcat(node->name, "\t", list, NULL);
-			free(temp);
+	struct __dir *dir;
+	size_t length, i;
+	char *list, *pos;
+
+	dir = _dir(r);
+	if (!dir) return NULL;
+
+	rwlock_rspin(&dir->lock);
+
+	if (!dir->count) {
+		rwlock_rfree(&dir->lock);
+		return NULL;
+	}
+
+	// one pass to size the list, one to fill it in
+	for (length = 0, i = 0; i < dir->count; i++) {
+		length += strlen(dir->entry[i].name) + 1;
+	}
+
+	list = malloc(length);
+	
+	if (list) {
+		for (pos = list, i = 0; i < dir->count; i++) {
+			length = strlen(dir->entry[i].name);
+			memcpy(pos, dir->entry[i].name, length);
+			pos += length;
+			*pos++ = '\t';
 		}
-		else {
-			list = strdup(node->name);
+		pos[-1] = '\0';
+	}
+
+	rwlock_rfree(&dir->lock);
+
+	return list;
+}
+
+/*
+ * Writes the full type string of <ro> (its own type followed by those of 
+ * its classes, space separated, as returned by the "type" rcall) to <buf>
+ * if it is not NULL, and returns its length.
+ */
+
+static size_t _typestr(char *buf, struct robject *ro) {
+	size_t length, total;
+
+	for (total = 0; ro; ro = ro->parent) {
+		if (!ro->type) continue;
+
+		length = strlen(ro->type);
+
+		if (buf) {
+			if (total) buf[total] = ' ';
+			memcpy(&buf[(total) ? total + 1 : 0], ro->type, length);
 		}
 
-		node = node->next;
+		total += (total) ? length + 1 : length;
 	}
 
-	if (list) {
-		return strdup(list);
+	if (buf) buf[total] = '\0';
+
+	return total;
+}
+
+#define LISTX_PAGE 256
+
+/*
+ * listx cursors are the last name of a page in hex, so that names with 
+ * spaces survive argument splitting; clients pass them back untouched.
+ */
+
+static char *_cursor_put(char *pos, const char *name) {
+	static const char digits[] = "0123456789abcdef";
+
+	for (; *name; name++) {
+		*pos++ = digits[(uint8_t) *name >> 4];
+		*pos++ = digits[(uint8_t) *name & 0xF];
 	}
-	else {
-		return NULL;
+
+	return pos;
+}
+
+static int _hexdigit(char c) {
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	return -1;
+}
+
+static char *_cursor_get(const char *cursor) {
+	size_t length, i;
+	int hi, lo;
+	char *name;
+
+	length = strlen(cursor);
+	if (!length || length % 2) return NULL;
+
+	name = malloc(length / 2 + 1);
+	if (!name) return NULL;
+
+	for (i = 0; i < length / 2; i++) {
+		hi = _hexdigit(cursor[2 * i]);
+		lo = _hexdigit(cursor[2 * i + 1]);
+
+		if (hi < 0 || lo < 0 || (hi | lo) == 0) {
+			free(name);
+			return NULL;
+		}
+
+		name[i] = (char) (hi << 4 | lo);
 	}
+	name[i] = '\0';
+
+	return name;
+}
+
+static char *_listx(struct robject *r, rp_t src, int argc, char **argv) {
+	struct __dirent *page[LISTX_PAGE], *entry;
+	struct __dir *dir;
+	uint32_t n, i, lo, hi, mid;
+	size_t length;
+	bool more;
+	char *after, *list, *pos;
+
+	dir = _dir(r);
+	if (!dir) return errorstr(ENOTDIR);
+
+	after = NULL;
+	if (argc > 1) {
+		after = _cursor_get(argv[1]);
+		if (!after) return errorstr(EINVAL);
+	}
+
+	rwlock_rspin(&dir->lock);
+
+	// pages go in name order and resume after the last name returned, so
+	// links and unlinks between pages (which reshuffle the array) can not
+	// make an entry that stays linked be skipped or listed twice. The page
+	// is picked in one pass, keeping the smallest names seen so far sorted.
+	more = false;
+	for (n = 0, i = 0; i < dir->count; i++) {
+		entry = &dir->entry[i];
+
+		if (after && strcmp(entry->name, after) <= 0) continue;
+
+		if (n == LISTX_PAGE) {
+			more = true;
+			if (strcmp(entry->name, page[n - 1]->name) > 0) continue;
+			n--;
+		}
+
+		for (lo = 0, hi = n; lo < hi;) {
+			mid = (lo + hi) / 2;
+			if (strcmp(page[mid]->name, entry->name) < 0) lo = mid + 1;
+			else hi = mid;
+		}
+
+		memmove(&page[lo + 1], &page[lo], sizeof(struct __dirent*) * (n - lo));
+		page[lo] = entry;
+		n++;
+	}
+
+	// size the reply: cursor for the next page, then one line per entry
+	length = (more) ? strlen(page[n - 1]->name) * 2 + 2 : 2;
+	for (i = 0; i < n; i++) {
+		length += strlen(page[i]->name) + _typestr(NULL, page[i]->ro) + 52;
+	}
+
+	list = malloc(length);
+
+	if (list) {
+		pos = list;
+		if (more) pos = _cursor_put(pos, page[n - 1]->name);
+		*pos++ = '\n';
+
+		for (i = 0; i < n; i++) {
+			entry = page[i];
+
+			pos += sprintf(pos, "%s\t@%u.%u\t", entry->name, getpid(), entry->ro->index);
+			pos += _typestr(pos, entry->ro);
+			pos += sprintf(pos, "\t%u:%u\n", 
+				(uint32_t) (entry->ro->size >> 32), (uint32_t) entry->ro->size);
+		}
+
+		*pos = '\0';
+	}
+
+	rwlock_rfree(&dir->lock);
+	free(after);
+
+	return list;
 }
 
 static char *_link(struct robject *r, rp_t src, int argc, char **argv) {
-	char *entry;
-	char *lookup;
-	uint32_t index;
 	struct robject *hardlink;
-	struct __dirent_list *list, *node;
+	struct __dir *dir;
+	uint32_t index;
+	int err;
 
 	if (argc == 3) {
-		entry = argv[1];
 		index = RP_INDEX(ator(argv[2]));
 
 		if (RP_PID(ator(argv[2])) != getpid()) {
@@ -148,26 +568,16 @@ static char *_link(struct robject *r, rp_t src, int argc, char **argv) {
 			return errorstr(ENOENT);
 		}
 
-		lookup = strvcat("dirent-", entry, NULL);
+		dir = _dir(r);
+		if (!dir) return errorstr(ENOTDIR);
 
-		if (robject_get_data(r, lookup)) {
-			// entry already exists; only change hardlink
-			robject_set_data(r, lookup, hardlink);
-			free(lookup);
-			return strdup("T");
-		}
-
-		robject_set_data(r, lookup, hardlink);
-		free(lookup);
+		rwlock_wspin(&dir->lock);
+		err = _dir_set(dir, argv[1], hardlink);
+		rwlock_wfree(&dir->lock);
 
-		list = robject_data(r, "list");
-		node = malloc(sizeof(struct __dirent_list));
-		node->next = list;
-		node->prev = NULL;
-		node->name = strdup(entry);
-		if (node->next) node->next->prev = node;
-		robject_set_data(r, "list", node);
+		if (err) return errorstr(ENOMEM);
 
+		robject_changed(r, "dir");
 		return strdup("T");
 	}
 
@@ -175,42 +585,23 @@ static char *_link(struct robject *r, rp_t src, int argc, char **argv) {
 }
 
 static char *_unlink(struct robject *r, rp_t src, int argc, char **argv) {
-	char *entry;
-	char *lookup;
-	struct __dirent_list *list;
+	struct __dir *dir;
+	int err;
 
 	if (argc == 2) {
-		entry = argv[1];
+		dir = _dir(r);
+		if (!dir) return errorstr(ENOTDIR);
 
-		lookup = strvcat("dirent-", entry, NULL);
+		rwlock_wspin(&dir->lock);
+		err = _dir_del(dir, argv[1]);
+		rwlock_wfree(&dir->lock);
 
-		if (!robject_get_data(r, lookup)) {
+		if (err) {
 			// entry does not exist, fail
-			free(lookup);
 			return errorstr(ENOENT);
 		}
 
-		robject_set_data(r, lookup, NULL);
-		free(lookup);
-
-		list = robject_data(r, "list");
-		while (list) {
-			if (!strcmp(list->name, entry)) {
-				if (list->prev) {
-					list->prev->next = list->next;
-				}
-				else {
-					robject_set_data(r, "list", list->next);
-				}
-
-				if (list->next) {
-					list->next->prev = list->prev;
-				}
-				break;
-			}
-			list = list->next;
-		}
-
+		robject_changed(r, "dir");
 		return strdup("T");
 	}
 
@@ -225,37 +616,37 @@ void __rdi_class_dir_setup() {
 
 	robject_set_call(rdi_class_dir, "find",   _find,   AC_NULL);
 	robject_set_call(rdi_class_dir, "list",   _list,   AC_READ);
+	robject_set_call(rdi_class_dir, "listx",  _listx,  AC_READ);
 	robject_set_call(rdi_class_dir, "link",   _link,   AC_ALTER);
 	robject_set_call(rdi_class_dir, "unlink", _unlink, AC_ALTER);
 
-	robject_set_data(rdi_class_dir, "type", (void*) "dir");
+	robject_set_type(rdi_class_dir, "dir");
 	robject_set_data(rdi_class_dir, "name", (void*) "RDI-class-dir");
 }
 
 struct robject *rdi_dir_cons(uint32_t index, uint32_t access) {
 	struct robject *r;
 
-	r = robject_cons(index, rdi_class_dir);
+	r = robject_cons_priv(index, rdi_class_dir, sizeof(struct __dir));
 	robject_set_default_access(r, access);
 
 	return r;
 }
 
 void rdi_dir_free(struct robject *r) {
-	struct __dirent_list *node, *temp_node;
-	char *temp;
+	struct __dir *dir;
+	uint32_t i;
 
-	node = robject_get_data(r, "list");
+	dir = _dir(r);
 
-	while (node) {		
-		temp = strvcat("dirent-", node->name, NULL);
-		free(robject_get_data(r, temp));
-		free(temp);
+	if (dir) {
+		// the entries are hard links; the objects they name live on
+		for (i = 0; i < dir->count; i++) {
+			free(dir->entry[i].name);
+		}
 
-		free(node->name);
-		temp_node = node->next;
-		free(node);
-		node = temp_node;
+		free(dir->entry);
+		free(dir->table);
 	}
 
 	robject_free(r);
@@ -273,7 +664,7 @@ void rdi_vfs_add(struct robject *root, const char *path, struct robject *r) {
 	// find parent directory
 	path1 = path_parent(path);
 	
-	dir = __find(root, path1, NULL);
+	dir = __find(root, path1, NULL, 0);
 	free(path1);
 
 	if (!dir) {
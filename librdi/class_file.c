@@ -100,6 +100,7 @@ static void __rdi_write(struct msg *msg) {
 	rdi_write_hook write_hook;
 	struct robject *file;
 	uint64_t offset;
+	off_t old_size;
 
 	if (msg->length < sizeof(uint64_t)) {
 		// message is of the wrong size
@@ -137,11 +138,18 @@ static void __rdi_write(struct msg *msg) {
 	// read parameter
 	offset = ((uint64_t*) msg->data)[0];
 
+	old_size = file->size;
+
 	((uint32_t*) msg->data)[0] = write_hook(file, msg->source, 
 		&msg->data[sizeof(uint64_t)], msg->length - sizeof(uint64_t), offset);
 	msg->length = sizeof(uint32_t);
 
 	mreply(msg);
+
+	// notify size caches if the file grew
+	if (file->size != old_size) {
+		robject_changed(file, NULL);
+	}
 }
 
 static void __rdi_share(struct msg *msg) {
@@ -273,15 +281,15 @@ static void __rdi_reset(struct msg *msg) {
 	free(robject_call(file, msg->source, msg->key, "reset"));
 
 	merror(msg);
+
+	robject_changed(file, NULL);
 }
 
 static char *_size(struct robject *r, rp_t src, int argc, char **argv) {
-	off_t *size;
-
-	size = robject_data(r, "size");
+	off_t size = r->size;
 
 	if (size) {
-		return saprintf("%u:%u", (uint32_t) (*size >> 32), (uint32_t) *size);
+		return saprintf("%u:%u", (uint32_t) (size >> 32), (uint32_t) size);
 	}
 	else {
 		return strdup("0");
@@ -308,21 +316,25 @@ void __rdi_class_file_setup() {
 	robject_set_call(rdi_class_file, "reset",  _reset,  AC_NULL);
 	robject_set_call(rdi_class_file, "finish", _finish, AC_WRITE);
 
-	robject_set_data(rdi_class_file, "type", (void*) "file");
+	robject_set_type(rdi_class_file, "file");
 	robject_set_data(rdi_class_file, "name", (void*) "RDI-class-file");
 
-	when(ACTION_READ,  __rdi_read);
-	when(ACTION_WRITE, __rdi_write);
-	when(ACTION_SYNC,  __rdi_sync);
-	when(ACTION_RESET, __rdi_reset);
-	when(ACTION_SHARE, __rdi_share);
-	when(ACTION_MMAP,  __rdi_mmap);
+	rdi_when(ACTION_READ,  __rdi_read);
+	rdi_when(ACTION_WRITE, __rdi_write);
+	rdi_when(ACTION_SYNC,  __rdi_sync);
+	rdi_when(ACTION_RESET, __rdi_reset);
+	rdi_when(ACTION_SHARE, __rdi_share);
+	rdi_when(ACTION_MMAP,  __rdi_mmap);
 }
 
 struct robject *rdi_file_cons(uint32_t index, uint32_t access) {
+	return rdi_file_cons_priv(index, access, 0);
+}
+
+struct robject *rdi_file_cons_priv(uint32_t index, uint32_t access, size_t priv_size) {
 	struct robject *r;
 
-	r = robject_cons(index, rdi_class_file);
+	r = robject_cons_priv(index, rdi_class_file, priv_size);
 	robject_set_default_access(r, access);
 
 	return r;
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2011-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -27,22 +27,33 @@
 
 static char *_find(struct robject *r, rp_t src, int argc, char **argv) {
 	char *link;
+	bool follow;
+	int i;
 
-	link = robject_get_data(r, "link");
+	if (argc < 2) {
+		return errorstr(EINVAL);
+	}
 
-	if (argc == 2) {
-		if (link) {
-			return saprintf(">> %s", link);
+	// -r (forwarding) is left to the caller here
+	follow = false;
+	for (i = 1; i < argc - 1; i++) {
+		if (!strcmp(argv[i], "-L")) {
+			follow = true;
 		}
-		else {
-			return rtoa(RP_CONS(getpid(), r->index));
+		else if (strcmp(argv[i], "-r")) {
+			return errorstr(EINVAL);
 		}
 	}
-	else if (argc == 3 && !strcmp(argv[1], "-L")) {
+
+	link = robject_get_data(r, "link");
+
+	if (link && !follow) {
+		// same "<link>/<tail>" form as a redirect from a directory
+		return saprintf(">> %s/%s", link, argv[argc - 1]);
+	}
+	else {
 		return rtoa(RP_CONS(getpid(), r->index));
 	}
-
-	return errorstr(EINVAL);
 }
 
 static char *_set_link(struct robject *r, rp_t src, int argc, char **argv) {
@@ -56,6 +67,15 @@ static char *_set_link(struct robject *r, rp_t src, int argc, char **argv) {
 		robject_set_data(r, "link", strdup(link));
 		free(old);
 
+		// only links set by root (or the driver itself) are forwarded across
+		if (RP_PID(src) == getpid() || getuser(RP_PID(src)) == 0) {
+			robject_set_data(r, "link-trusted", (void*) 1);
+		}
+		else {
+			robject_set_data(r, "link-trusted", NULL);
+		}
+
+		robject_changed(r, "dir");
 		return strdup("T");
 	}
 
@@ -76,7 +96,7 @@ void __rdi_class_link_setup() {
 	robject_set_call(rdi_class_link, "set-link", _set_link, AC_WRITE);
 	robject_set_call(rdi_class_link, "get-link", _get_link, AC_READ);
 
-	robject_set_data(rdi_class_link, "type", (void*) "link");
+	robject_set_type(rdi_class_link, "link");
 	robject_set_data(rdi_class_link, "name", (void*) "RDI-class-link");
 }
 
@@ -85,7 +105,10 @@ struct robject *rdi_link_cons(uint32_t index, uint32_t access, const char *link)
 
 	r = robject_cons(index, rdi_class_link);
 	robject_set_default_access(r, access);
-	if (link) robject_set_data(r, "link", strdup(link));
+	if (link) {
+		robject_set_data(r, "link", strdup(link));
+		robject_set_data(r, "link-trusted", (void*) 1);
+	}
 
 	return r;
 }
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2012 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * 
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <rho/mutex.h>
+#include <rho/ipc.h>
+
+#include <rdi/core.h>
+
+/*
+ * Request dispatch.
+ *
+ * The kernel starts a new thread for every message a driver receives. With
+ * a concurrency limit set, at most that many of those threads run request
+ * handlers at once: a thread that arrives while the limit is reached queues
+ * its message in the port's mqueue and exits, and every active handler 
+ * drains the queues before it retires. If a message cannot be queued, its
+ * thread handles it anyway, briefly exceeding the limit. Ports are drained
+ * round-robin, so a flood on one port does not starve the others.
+ */
+
+static void (*_handler[256])(struct msg *msg);
+
+static uint8_t  _port[256];   // ports registered through rdi_when
+static uint32_t _ports;
+static uint32_t _next_port;
+
+static uint32_t _limit;       // 0 means no limit
+static uint32_t _active;
+static bool _mutex;
+
+// returns the next queued request, or retires the calling handler
+static struct msg *_next(void) {
+	struct msg *msg;
+	uint32_t i;
+
+	mutex_spin(&_mutex);
+
+	for (i = 0; i < _ports; i++) {
+		msg = mqueue_pull(_port[(_next_port + i) % _ports], 0);
+
+		if (msg) {
+			_next_port = (_next_port + i + 1) % _ports;
+			mutex_free(&_mutex);
+			return msg;
+		}
+	}
+
+	_active--;
+	mutex_free(&_mutex);
+
+	return NULL;
+}
+
+static void _dispatch(struct msg *msg) {
+
+	if (!_limit) {
+		_handler[msg->action](msg);
+		return;
+	}
+
+	mutex_spin(&_mutex);
+
+	if (_active >= _limit) {
+		// queued under the lock, so no handler can retire without seeing it
+		if (!mqueue_push(msg)) {
+			mutex_free(&_mutex);
+			return;
+		}
+
+		// the queue could not take it; run over the limit rather than drop
+		// a request whose sender is waiting on a reply
+	}
+
+	_active++;
+	mutex_free(&_mutex);
+
+	while (msg) {
+		_handler[msg->action](msg);
+		msg = _next();
+	}
+}
+
+/*****************************************************************************
+ * rdi_when
+ *
+ * Registers <handler> for requests on <port>, subject to the concurrency
+ * limit set with rdi_set_concurrency.
+ */
+
+void rdi_when(uint8_t port, void (*handler)(struct msg *msg)) {
+	uint32_t i;
+
+	mutex_spin(&_mutex);
+
+	_handler[port] = handler;
+
+	for (i = 0; i < _ports; i++) {
+		if (_port[i] == port) break;
+	}
+	if (i == _ports) {
+		_port[_ports++] = port;
+	}
+
+	mutex_free(&_mutex);
+
+	when(port, (handler) ? _dispatch : NULL);
+}
+
+/*****************************************************************************
+ * rdi_set_concurrency
+ *
+ * Limits the number of requests handled at once by this process to <limit>,
+ * or removes the limit if <limit> is zero (the default). Drivers whose 
+ * handlers serialize on a lock anyway should set a small limit at init, so
+ * bursts queue up instead of spinning. A handler that waits for another 
+ * request to arrive (like a pipe read waiting for a write) must not run 
+ * under a limit it can exhaust.
+ */
+
+void rdi_set_concurrency(uint32_t limit) {
+	_limit = limit;
+}
@@ -32,6 +32,11 @@
 
 void rdi_init();
 
+// request dispatch: handlers registered with rdi_when run at most <limit>
+// at a time once rdi_set_concurrency is called; excess requests are queued
+void rdi_when(uint8_t port, void (*handler)(struct msg *msg));
+void rdi_set_concurrency(uint32_t limit);
+
 /*****************************************************************************
  * rdi_class_core (extends robject_class_basic) - driver
  *
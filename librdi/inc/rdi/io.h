@@ -31,9 +31,9 @@
  *
  * Fields:
  *
- * size
+ * size (well-known field ro->size; set with robject_set_size)
  *
- *   Type: off_t * (heap-allocated)
+ *   Type: off_t
  *
  * read
  *
@@ -52,6 +52,7 @@ extern struct robject *rdi_class_file;
 void __rdi_class_file_setup();
 
 struct robject *rdi_file_cons(uint32_t index, uint32_t access);
+struct robject *rdi_file_cons_priv(uint32_t index, uint32_t access, size_t priv_size);
 void            rdi_file_free(struct robject *r);
 
 typedef size_t (*rdi_read_hook) (struct robject *r, rp_t src, uint8_t *buf, size_t size, off_t off);
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2011-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -47,6 +47,12 @@ void __robject_init(void);
 // rcall hook format
 typedef char *(*rcall_t)(struct robject *self, rp_t src, int argc, char **argv);
 
+// binary rcall hook format
+typedef int (*brcall_t)(struct robject *self, rp_t src, int argc, struct brcall_arg *argv);
+
+// maximum binary rcall method ID
+#define BRCALL_MAXID 256
+
 /*****************************************************************************
  * Rhombus Object Indexing and Lookup
  */
@@ -63,7 +69,7 @@ uint32_t robject_new_index(void);
  */
 
 struct robject {
-	bool     mutex; // OPT - this should be a readers/writer lock
+	uint32_t lock;  // reader/writer lock protecting the fields below
 	bool     driver_mutex;
 	uint32_t index; // object index within process; do not modify
 
@@ -74,22 +80,55 @@ struct robject {
 	struct robject *parent;
 
 	// robject fields
-	struct s_table *call_table; // table of rcall hooks
-	struct s_table *call_class; // table of rcall action classes
-	struct s_table *data_table; // table of general data
+	struct s_map   *call_table; // table of rcall hooks and classes (by atom)
+	struct s_map   *data_table; // table of general data (by atom)
 	struct s_table *subs_table; // table of event subscribers
-	struct s_table *accs_table; // table of user access bitmaps
+	struct s_map   *accs_table; // table of user access bitmaps (by user ID)
+	int accs_default;           // access bitmap for users not in accs_table
+
+	// processes caching results about this object (see robject_changed)
+	uint32_t *cacher;
+	uint32_t  cacher_count;
+
+	// binary rcall dispatch array, indexed by method ID
+	struct robject_brcall *brcall_table;
+	uint32_t brcall_count;
+
+	// well-known fields; read directly. robject_set_type/size also notify
+	// caches, which a write hook need not do (__rdi_write does it for size)
+	const char *type; // type string of this object (not including parents)
+	off_t size;       // size of contents, for objects that have one
+
+	// driver-private area, sized at construction; NULL if none was asked for
+	void  *priv;
+	size_t priv_size;
+};
+
+struct robject_rcall {
+	rcall_t     hook;
+	int         class;
+};
+
+struct robject_brcall {
+	brcall_t    hook;
+	const char *sig;
+	int         class;
 };
 
 // constructor/destructor
 struct robject *robject_cons(uint32_t index, struct robject *parent);
+struct robject *robject_cons_priv(uint32_t index, struct robject *parent, size_t priv_size);
 void            robject_free(struct robject *ro);
 
 // various field manipulations
 void    robject_set_call(struct robject *ro, const char *call, rcall_t hook, int status);
 rcall_t robject_get_call(struct robject *ro, const char *call);
+void    robject_set_type(struct robject *ro, const char *type);
+void    robject_set_size(struct robject *ro, off_t size);
 void    robject_set_data(struct robject *ro, const char *field, void *data);
 void   *robject_get_data(struct robject *ro, const char *field);
+void    robject_set_brcall(struct robject *ro, uint32_t method, const char *sig, brcall_t hook, int status);
+int     robject_get_brcall(struct robject *ro, uint32_t method, struct robject_brcall *entry);
 
 // type system
 int robject_is_type(const char *typestr, const char *type);
@@ -97,13 +136,32 @@ int robject_check_type(struct robject *ro, const char *type);
 
 // permission system
 int  robject_check_access(struct robject *ro, rp_t source, int access);
-void robject_set_access  (struct robject *ro, rp_t source, int access);
-int  robject_get_access  (struct robject *ro, rp_t source);
+void robject_set_access  (struct robject *ro, uint32_t user, int access);
+int  robject_get_access  (struct robject *ro, uint32_t user);
 void robject_set_default_access(struct robject *ro, int access);
 
+// change notification: tells processes caching type, size, key or find
+// results for this robject to drop them. <what> is NULL, or "dir" if the 
+// directory entries (and therefore path lookups) changed. Only processes
+// registered with robject_watch (which robject_call does for cacheable
+// calls) are told.
+void robject_watch  (struct robject *ro, rp_t source);
+void robject_changed(struct robject *ro, const char *what);
+
+// event coalescing rule format
+typedef char *(*robject_coalesce_t)(const char *old, const char *new);
+
+// batched event delivery
+void  robject_event_flush   (void);
+void  robject_event_batch   (size_t threshold);
+void  robject_event_coalesce(const char *prefix, robject_coalesce_t rule);
+char *robject_coalesce_last (const char *old, const char *new);
+char *robject_coalesce_sum  (const char *old, const char *new);
+
 // basic interface
 void  robject_event(struct robject *ro, const char *event);
 char *robject_call (struct robject *ro, rp_t source, rk_t key, const char *args);
+int   robject_brcall(struct robject *ro, rp_t source, rk_t key, uint32_t method, const char *sig, struct brcall_arg *argv);
 void *robject_data (struct robject *ro, const char *field);
 
 #endif/*__RLIBC_ROBJECT_H*/
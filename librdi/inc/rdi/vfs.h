@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009-2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2009-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -25,9 +25,10 @@
  *
  * Calls:
  *
- * find <path> - R
+ * find [-L] [-r] <path> - R
  *
  *   Attempt to locate the robject with the given path in the directory tree.
+ *   With -L, a symlink at the end of the path is not followed.
  *
  *   Default behavior is complex.
  *
@@ -35,14 +36,35 @@
  *     symlink hit: ">> %s/%s" <link contents> <remaining path>
  *     no symlink: "%r" <pointer to robject>
  *
+ *   With -r, a hit on a trusted symlink (see rdi_class_link) whose contents
+ *   start with a resource pointer is followed by asking that driver to find
+ *   the rest of the path, so that paths across a mountpoint are resolved in
+ *   one round trip. The redirect and that driver's answer are returned, one
+ *   per line; the last line is the result, which may be another redirect.
+ *
  * list - R
  *
  *   List the contents of the directory.
  *
  *   Default behavior is to concatenate all of the directory entry names
- *   separated by spaces, escaping spaces within individual entries.
+ *   separated by tabs.
+ *
+ *   Return: directory contents, tab separated.
+ *
+ * listx [cursor] - R
  *
- *   Return: directory contents, space separated.
+ *   List the contents of the directory along with each entry's resource 
+ *   pointer, type and size, so that a listing costs one round trip per 
+ *   page instead of one per entry. Entries are returned in name order, at
+ *   most 256 at a time, starting at the beginning or where the page that
+ *   returned <cursor> left off. Entries that stay linked for the whole 
+ *   listing are returned exactly once, even if others are linked or 
+ *   unlinked between pages.
+ *
+ *   Return: the cursor for the next page, an opaque token without spaces 
+ *   (an empty line if this is the last page), then one line per entry: 
+ *   "%s\t%r\t%s\t%u:%u" <name> <pointer> <type> <size>, each line ending
+ *   in a newline.
  *
  * link <entry> <index> - W
  *
@@ -58,14 +80,12 @@
  *   Default behavior is to remove the directory entry iff the directory has
  *   write access.
  *
- * Fields:
- *
- * dirent-%s <entry>
- *
- *   Directory entry (i.e. hard link) corresponding to the embedded entry
- *   name.
+ * Private area:
  *
- *   Type: struct robject * (extending rdi_class_core)
+ *   Directories constructed with rdi_dir_cons keep their entries (i.e. hard
+ *   links to robjects) in a hashed index in the object's private area, so 
+ *   lookup, link and unlink are O(1) and listing is linear. Directory 
+ *   objects are therefore not available for driver-private data.
  */
 
 extern struct robject *rdi_class_dir;
@@ -81,9 +101,9 @@ void rdi_vfs_add(struct robject *dir, const char *path, struct robject *r);
  *
  * Calls:
  *
- * find <path> - R
+ * find [-L] [-r] <path> - R
  *
- *   Return: ">> %s/%s" <link contents> <path>
+ *   Return: ">> %s/%s" <link contents> <path>, or the link itself with -L
  *
  * get-link - R
  *
@@ -100,6 +120,14 @@ void rdi_vfs_add(struct robject *dir, const char *path, struct robject *r);
  *   Symbolic link redirect.
  *   
  *   Type: char * (heap-allocated)
+ *
+ * link-trusted
+ *
+ *   Non-NULL if the link was set by the driver (through rdi_link_cons) or
+ *   by a root process. Only trusted links are followed by find -r, since
+ *   that makes the driver wait on the link's target.
+ *
+ *   Type: flag
  */
 
 extern struct robject *rdi_class_link;
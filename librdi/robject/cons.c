@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2011-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -15,6 +15,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #include <rho/struct.h>
@@ -24,26 +25,55 @@
 #include <rdi/robject.h>
 
 struct robject *robject_cons(uint32_t index, struct robject *parent) {
+	return robject_cons_priv(index, parent, 0);
+}
+
+/*
+ * Constructs an robject with <priv_size> bytes of zeroed driver-private 
+ * space, allocated along with the object and reachable through ro->priv.
+ * Drivers keep their per-object hot data there instead of in the data 
+ * table, which costs a hashed lookup under the object lock on every access.
+ */
+
+struct robject *robject_cons_priv(uint32_t index, struct robject *parent, size_t priv_size) {
 	struct robject *robject;
 
-	robject = malloc(sizeof(struct robject));
-	robject->mutex = false;
+	robject = malloc(sizeof(struct robject) + priv_size);
+	if (!robject) return NULL;
+
+	robject->lock = 0;
 	robject->driver_mutex = false;
 	robject->index = index;
 	robject->parent = parent;
 
 	robject->call_table = NULL;
-	robject->call_class = NULL;
 	robject->data_table = NULL;
 	robject->subs_table = NULL;
 	robject->accs_table = NULL;
+	robject->accs_default = 0;
+
+	robject->cacher = NULL;
+	robject->cacher_count = 0;
+
+	robject->brcall_table = NULL;
+	robject->brcall_count = 0;
+
+	robject->type = NULL;
+	robject->size = 0;
+
+	if (priv_size) {
+		robject->priv = &robject[1];
+		robject->priv_size = priv_size;
+		memclr(robject->priv, priv_size);
+	}
+	else {
+		robject->priv = NULL;
+		robject->priv_size = 0;
+	}
 
 	// generate random keys
-	// XXX SEC - this should be replaced with a secure RNG ASAP
 	robject->key[0] = 0ULL;
-	for (int i = 1; i < 8; i++) {
-		robject->key[i] = (uint64_t) rand() | (uint64_t) rand() << 32ULL;
-	}
+	memrandx(&robject->key[1], sizeof(robject->key[0]) * 7);
 
 	if (index) {
 		robject_set(index, robject);
@@ -52,20 +82,28 @@ struct robject *robject_cons(uint32_t index, struct robject *parent) {
 	return robject;
 }
 
+static void _free_rcall(void *arg, uint32_t atom, void *entry) {
+	free(entry);
+}
+
 void robject_free(struct robject *ro) {
 
+	robject_changed(ro, NULL);
+
 	// remove from table (if in table)
 	if (ro->index) {
 		robject_set(ro->index, NULL);
 	}
 
-	mutex_spin(&ro->mutex);
+	rwlock_wspin(&ro->lock);
 
-	s_table_free(ro->call_table);
-	s_table_free(ro->call_class);
-	s_table_free(ro->data_table);
+	s_map_iter(ro->call_table, NULL, _free_rcall);
+	s_map_free(ro->call_table);
+	s_map_free(ro->data_table);
 	s_table_free(ro->subs_table);
-	s_table_free(ro->accs_table);
+	s_map_free(ro->accs_table);
+	free(ro->brcall_table);
+	free(ro->cacher);
 
 	free(ro);
 }
@@ -0,0 +1,363 @@
+/*
+ * Copyright (C) 2012 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * 
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdio.h>
+
+#include <rho/struct.h>
+#include <rho/natio.h>
+#include <rho/mutex.h>
+#include <rho/proc.h>
+#include <rho/page.h>
+#include <rho/ipc.h>
+
+#include <rdi/robject.h>
+
+/*****************************************************************************
+ * Batched event delivery
+ *
+ * Instead of sending one message per event per subscriber, events are 
+ * appended to a per-subscriber outgoing buffer, and each buffer is sent as a
+ * single ACTION_EVENT message containing several NUL-terminated event 
+ * strings. A buffer is flushed when it reaches the batch threshold, or when
+ * the process next goes idle: the first event put into an empty buffer 
+ * starts a flusher thread, which yields once to let the producer run on, 
+ * then sends everything that is pending.
+ *
+ * Consecutive events to the same subscriber may also be coalesced by rules
+ * registered per event prefix (e.g. summing "mouse delta" events). Only an
+ * event and the one directly before it are ever merged, so the relative 
+ * order of different events is preserved.
+ */
+
+#define EVENT_BUFSZ (PAGESZ - sizeof(struct msg))
+#define EVENT_RULES 16
+
+struct event_buf {
+	bool   mutex;
+	size_t length; // bytes pending
+	size_t last;   // offset of the most recent pending event
+	char   data[EVENT_BUFSZ];
+};
+
+struct event_rule {
+	char *prefix;
+	size_t length;
+	robject_coalesce_t rule;
+};
+
+static struct event_buf *_evbuf[MAX_PID];
+static bool _evbuf_mutex;
+
+static struct event_rule _rules[EVENT_RULES];
+static int  _rule_count;
+static bool _rule_mutex;
+
+static size_t _threshold = EVENT_BUFSZ / 2;
+static bool   _flusher_active;
+
+/*****************************************************************************
+ * _flush
+ *
+ * Send the pending events of <buf> to process <pid>. The buffer's mutex 
+ * must be held by the caller.
+ */
+
+static void _flush(uint32_t pid, struct event_buf *buf) {
+	struct msg *msg;
+
+	if (!buf->length) {
+		return;
+	}
+
+	msg = aalloc(sizeof(struct msg) + buf->length, PAGESZ);
+
+	if (msg) {
+		msg->source = RP_CONS(getpid(), 0);
+		msg->target = RP_CONS(pid, 0);
+		msg->length = buf->length;
+		msg->action = ACTION_EVENT;
+		msg->arch   = ARCH_NAT;
+		memcpy(msg->data, buf->data, buf->length);
+
+		msend(msg);
+	}
+
+	buf->length = 0;
+	buf->last   = 0;
+}
+
+static void _flusher(void) {
+
+	// let producers run on and fill buffers until they go idle
+	sleep();
+
+	_flusher_active = false;
+	robject_event_flush();
+
+	done();
+}
+
+static int _find_rule(const char *event) {
+	int i;
+
+	mutex_spin(&_rule_mutex);
+	for (i = 0; i < _rule_count; i++) {
+		if (!strncmp(event, _rules[i].prefix, _rules[i].length)) {
+			mutex_free(&_rule_mutex);
+			return i;
+		}
+	}
+	mutex_free(&_rule_mutex);
+
+	return -1;
+}
+
+/*****************************************************************************
+ * _queue
+ *
+ * Queue <event> for delivery to process <pid>, coalescing it with the last
+ * pending event if a rule allows.
+ */
+
+static void _queue(uint32_t pid, const char *event, int rule) {
+	struct event_buf *buf;
+	size_t length;
+	char *merged;
+	bool start_flusher;
+
+	if (pid >= MAX_PID) {
+		return;
+	}
+
+	if (!_evbuf[pid]) {
+		buf = malloc(sizeof(struct event_buf));
+		if (!buf) return;
+		buf->mutex  = false;
+		buf->length = 0;
+		buf->last   = 0;
+
+		mutex_spin(&_evbuf_mutex);
+		if (!_evbuf[pid]) {
+			_evbuf[pid] = buf;
+		}
+		else {
+			free(buf);
+		}
+		mutex_free(&_evbuf_mutex);
+	}
+
+	buf = _evbuf[pid];
+	merged = NULL;
+
+	mutex_spin(&buf->mutex);
+
+	if (rule >= 0 && buf->length && _find_rule(&buf->data[buf->last]) == rule) {
+		merged = _rules[rule].rule(&buf->data[buf->last], event);
+
+		if (merged) {
+			// drop the last event; the merged one replaces it
+			buf->length = buf->last;
+			event = merged;
+		}
+	}
+
+	length = strlen(event) + 1;
+
+	if (length > EVENT_BUFSZ) {
+		mutex_free(&buf->mutex);
+		free(merged);
+		return;
+	}
+
+	if (buf->length + length > EVENT_BUFSZ) {
+		_flush(pid, buf);
+	}
+
+	start_flusher = (buf->length == 0);
+
+	buf->last = buf->length;
+	memcpy(&buf->data[buf->length], event, length);
+	buf->length += length;
+
+	if (buf->length >= _threshold) {
+		_flush(pid, buf);
+		start_flusher = false;
+	}
+
+	mutex_free(&buf->mutex);
+	free(merged);
+
+	if (start_flusher && mutex_lock(&_flusher_active)) {
+		if (also(_flusher) == (uint32_t) -1) {
+			_flusher_active = false;
+		}
+	}
+}
+
+struct event_iter {
+	const char *event;
+	int rule;
+};
+
+static void _iter(void *arg0, const char *key, void *value) {
+	struct event_iter *iter = arg0;
+
+	_queue(atoi(key), iter->event, iter->rule);
+}
+
+/*****************************************************************************
+ * robject_event
+ *
+ * Send <event> to every subscriber of <ro>. Delivery is batched.
+ */
+
+void robject_event(struct robject *ro, const char *event) {
+	struct event_iter iter;
+	
+	if (ro && event) {
+		iter.event = event;
+		iter.rule  = _find_rule(event);
+
+		rwlock_rspin(&ro->lock);
+		s_table_iter(ro->subs_table, &iter, _iter);
+		rwlock_rfree(&ro->lock);
+	}
+}
+
+/*****************************************************************************
+ * robject_event_flush
+ *
+ * Immediately send all pending events to all subscribers.
+ */
+
+void robject_event_flush(void) {
+	uint32_t pid;
+
+	for (pid = 0; pid < MAX_PID; pid++) {
+		if (_evbuf[pid] && _evbuf[pid]->length) {
+			mutex_spin(&_evbuf[pid]->mutex);
+			_flush(pid, _evbuf[pid]);
+			mutex_free(&_evbuf[pid]->mutex);
+		}
+	}
+}
+
+/*****************************************************************************
+ * robject_event_batch
+ *
+ * Set the number of pending bytes for a single subscriber at which events
+ * are sent without waiting for the process to go idle. A threshold of zero
+ * disables batching.
+ */
+
+void robject_event_batch(size_t threshold) {
+	_threshold = (threshold > EVENT_BUFSZ) ? EVENT_BUFSZ : threshold;
+}
+
+/*****************************************************************************
+ * robject_event_coalesce
+ *
+ * Register <rule> to merge consecutive pending events that both begin with
+ * <prefix>. The rule is given the older and newer event strings, and 
+ * returns a heap-allocated merged event, or NULL to keep both.
+ */
+
+void robject_event_coalesce(const char *prefix, robject_coalesce_t rule) {
+	
+	mutex_spin(&_rule_mutex);
+	if (_rule_count < EVENT_RULES) {
+		_rules[_rule_count].prefix = strdup(prefix);
+		_rules[_rule_count].length = strlen(prefix);
+		_rules[_rule_count].rule   = rule;
+		_rule_count++;
+	}
+	mutex_free(&_rule_mutex);
+}
+
+/*****************************************************************************
+ * robject_coalesce_last
+ *
+ * Coalescing rule that keeps only the newer event (e.g. for resizes).
+ */
+
+char *robject_coalesce_last(const char *old, const char *new) {
+	return strdup(new);
+}
+
+/*****************************************************************************
+ * robject_coalesce_sum
+ *
+ * Coalescing rule that adds the numeric arguments of two events with the
+ * same non-numeric words (e.g. "mouse delta 3 -1" and "mouse delta 2 2" 
+ * become "mouse delta 5 1"). Returns NULL if the events do not line up.
+ */
+
+char *robject_coalesce_sum(const char *old, const char *new) {
+	char **oldv, **newv;
+	char *merged, *temp;
+	char number[16];
+	int i;
+
+	oldv = strparse(old, " ");
+	newv = strparse(new, " ");
+	merged = NULL;
+
+	if (!oldv || !newv) {
+		goto done;
+	}
+
+	for (i = 0; oldv[i] && newv[i]; i++) {
+		if (isdigit(oldv[i][0]) || (oldv[i][0] == '-' && isdigit(oldv[i][1]))) {
+			sprintf(number, "%d", atoi(oldv[i]) + atoi(newv[i]));
+			temp = merged;
+			merged = (temp) ? strvcat(temp, " ", number, NULL) : strdup(number);
+		}
+		else if (!strcmp(oldv[i], newv[i])) {
+			temp = merged;
+			merged = (temp) ? strvcat(temp, " ", oldv[i], NULL) : strdup(oldv[i]);
+		}
+		else {
+			// events do not line up
+			temp = merged;
+			merged = NULL;
+			free(temp);
+			break;
+		}
+
+		free(temp);
+	}
+
+	if (oldv[i] || newv[i]) {
+		free(merged);
+		merged = NULL;
+	}
+
+	done:
+	if (oldv) {
+		for (i = 0; oldv[i]; i++) free(oldv[i]);
+		free(oldv);
+	}
+	if (newv) {
+		for (i = 0; newv[i]; i++) free(newv[i]);
+		free(newv);
+	}
+
+	return merged;
+}
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2011-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -21,246 +21,67 @@
 
 #include <rdi/robject.h>
 
-static bool _mutex = false;
-
 /*
- * AVL tree implementation for hash table buckets.
+ * Radix table for object lookup.
+ *
+ * Indexes are split 8/12/12 bits into a static root, middle nodes, and
+ * leaves of robject pointers. robject_new_index() hands out dense indexes
+ * from 1, so in practice only the first middle node and a few leaves are
+ * ever allocated, but any 32-bit index a client sends is handled.
+ *
+ * Nodes are only ever added, never freed or moved, so readers take no
+ * locks: they follow at most three pointers, each of which is either NULL
+ * or a fully initialized node, since a node is zeroed before it is
+ * published. Writers serialize on _mutex only to allocate nodes; a slot 
+ * update is a single aligned store.
  */
 
-struct __bucket {
-	struct __bucket *l;
-	struct __bucket *r;
-	int32_t balance;
-	uint32_t height;
-
-	uint32_t index;
-	struct robject *ro;
-};
-
-static void _update_height_balance(struct __bucket *root) {
-	uint32_t height_l;
-	uint32_t height_r;
-
-	height_l = (root->l) ? root->l->height + 1 : 0;
-	height_r = (root->r) ? root->r->height + 1 : 0;
-	root->height = (height_l > height_r) ? height_l : height_r;
-	root->balance = height_l - height_r;
-}
-
-static struct __bucket *_tree_balance(struct __bucket *root) {
-	struct __bucket *temp;
-	
-	if (root->balance < 2 && root->balance > -2) {
-		// no balancing needed
-		return root;
-	}
-
-	if (root->balance < 0) {
-		// left rotation needed
-
-		if (root->r->balance > 0) {
-			// right rotation on right subtree needed first
-			temp = root->r->l;
-			root->r->l = temp->r;
-			temp->r = root->r;
-			root->r = temp;
-
-			_update_height_balance(temp);
-			_update_height_balance(root->r);
-		}
-
-		temp = root->r;
-		root->r = temp->l;
-		temp->l = root;
-
-		_update_height_balance(root);
-		_update_height_balance(temp);
-		return temp;
-	}
-	else {
-		// right rotation needed
-		
-		if (root->l->balance < 0) {
-			// left rotation on left subtree needed first
-			temp = root->l->r;
-			root->l->r = temp->l;
-			temp->l = root->l;
-			root->l = temp;
-
-			_update_height_balance(temp);
-			_update_height_balance(root->l);
-		}
-
-		temp = root->l;
-		root->l = temp->r;
-		temp->r = root;
-
-		_update_height_balance(root);
-		_update_height_balance(temp);
-		return temp;
-	}
-}
-
-static struct __bucket *_new_bucket(struct robject *ro, uint32_t index) {
-	struct __bucket *new_bucket;
-
-	new_bucket = malloc(sizeof(struct __bucket));
-	if (!new_bucket) return NULL;
-
-	new_bucket->l = NULL;
-	new_bucket->r = NULL;
-	new_bucket->index = index;
-	new_bucket->ro = ro;
-	new_bucket->balance = 0;
-	new_bucket->height = 0;
-
-	return new_bucket;
-}
-
-static struct __bucket *_tree_get(struct __bucket *root, uint32_t index) {
-	
-	// made this iterative for speed (we want lookup to be as fast as possible)
-	while (root) {
-		if (index == root->index) {
-			return root;
-		}
-
-		root = (index < root->index) ? root->l : root->r;
-	}
-
-	return NULL;
-}
-
-static struct __bucket *_tree_set(struct __bucket *root, uint32_t index, struct robject *ro) {
-	
-	if (!root) {
-		return _new_bucket(ro, index);
-	}
-
-	if (index == root->index) {
-		root->ro = ro;
-		return root;
-	}
-
-	if (index < root->index) {
-		root->l = _tree_set(root->l, index, ro);
-	}
-	else {
-		root->r = _tree_set(root->r, index, ro);
-	}
+#define ROOT_BITS 8
+#define NODE_BITS 12
+#define LEAF_BITS 12
 
-	_update_height_balance(root);
-	return _tree_balance(root);
-}
+#define ROOT_SIZE (1 << ROOT_BITS)
+#define NODE_SIZE (1 << NODE_BITS)
+#define LEAF_SIZE (1 << LEAF_BITS)
 
-static uint32_t _tree_max_index(struct __bucket *root) {
-	
-	if (!root) {
-		return 0;
-	}
+#define ROOT_INDEX(i) ((i) >> (NODE_BITS + LEAF_BITS))
+#define NODE_INDEX(i) (((i) >> LEAF_BITS) & (NODE_SIZE - 1))
+#define LEAF_INDEX(i) ((i) & (LEAF_SIZE - 1))
 
-	if (root->r) {
-		return _tree_max_index(root->r);
-	}
-	else {
-		return root->index;
-	}
-}
-
-static struct __bucket *_tree_del(struct __bucket *root, uint32_t index) {
-	struct __bucket *temp;
-	uint32_t max;
-	
-	if (!root) {
-		return NULL;
-	}
+struct __leaf {
+	struct robject *volatile ro[LEAF_SIZE];
+};
 
-	if (root->index == index) {
-		// found node to be deleted
+struct __node {
+	struct __leaf *volatile leaf[NODE_SIZE];
+};
 
-		if (!root->l && !root->r) {
-			// no children
-			free(root);
-			return NULL;
-		}
+static struct __node *volatile _root[ROOT_SIZE];
+static bool _mutex = false;
 
-		if (!root->l) {
-			// right child only
-			temp = root->r;
-			free(root);
-			return temp;
-		}
-		
-		if (!root->r) {
-			// left child only
-			temp = root->l;
-			free(root);
-			return temp;
-		}
+static struct robject *volatile *_slot(uint32_t index, bool alloc) {
+	struct __node *node;
+	struct __leaf *leaf;
 
-		// both children exist
-		max = _tree_max_index(root->l);
-		temp = _tree_get(root->l, max);
-		temp = _new_bucket(temp->ro, max);
-		temp->l = _tree_del(root->l, max);
-		temp->r = root->r;
-		free(root);
-		
-		_update_height_balance(temp);
-		return _tree_balance(temp);
-	}
+	node = _root[ROOT_INDEX(index)];
+	if (!node) {
+		if (!alloc) return NULL;
 
-	if (index < root->index) {
-		root->l = _tree_del(root->l, index);
-		return root;
-	}
-	else {
-		root->r = _tree_del(root->r, index);
-		return root;
+		node = calloc(1, sizeof(struct __node));
+		if (!node) return NULL;
+		_root[ROOT_INDEX(index)] = node;
 	}
-}
-
-/*
- * Hashtable with trees for chains for object lookup.
- */
 
-static struct __bucket *_table[256];
+	leaf = node->leaf[NODE_INDEX(index)];
+	if (!leaf) {
+		if (!alloc) return NULL;
 
-static uint8_t _hash(uint32_t index) {
-	uint8_t hash;
-
-	hash = index >> 24;
-	hash = (hash << 5) - hash + (index >> 16);
-	hash = (hash << 5) - hash + (index >> 8);
-	hash = (hash << 5) - hash + index;
-
-	return hash;
-}
-
-static void _set(uint32_t index, struct robject *ro) {
-	uint8_t hash = _hash(index);
-
-	_table[hash] = _tree_set(_table[hash], index, ro);
-}
-
-static struct robject *_get(uint32_t index) {
-	uint8_t hash = _hash(index);
-	struct __bucket *bucket;
-
-	bucket = _tree_get(_table[hash], index);
-
-	if (bucket) {
-		return bucket->ro;
+		leaf = calloc(1, sizeof(struct __leaf));
+		if (!leaf) return NULL;
+		node->leaf[NODE_INDEX(index)] = leaf;
 	}
-	else {
-		return NULL;
-	}
-}
-
-static void _del(uint32_t index) {
-	uint8_t hash = _hash(index);
 
-	_table[hash] = _tree_del(_table[hash], index);
+	return &leaf->ro[LEAF_INDEX(index)];
 }
 
 /*
@@ -268,27 +89,27 @@ static void _del(uint32_t index) {
  */
 
 void robject_set(uint32_t index, struct robject *ro) {
+	struct robject *volatile *slot;
 
-	mutex_spin(&_mutex);
-	if (ro) {
-		mutex_spin(&ro->mutex);
-		_set(index, ro);
-		mutex_free(&ro->mutex);
-	}
-	else {
-		_del(index);
+	if (!ro) {
+		// nothing to clear if the leaf was never allocated
+		slot = _slot(index, false);
+		if (slot) *slot = NULL;
+		return;
 	}
+
+	mutex_spin(&_mutex);
+	slot = _slot(index, true);
+	if (slot) *slot = ro;
 	mutex_free(&_mutex);
 }
 
 struct robject *robject_get(uint32_t index) {
-	struct robject *robject;
+	struct robject *volatile *slot;
 
-	mutex_spin(&_mutex);
-	robject = _get(index);
-	mutex_free(&_mutex);
+	slot = _slot(index, false);
 
-	return robject;
+	return (slot) ? *slot : NULL;
 }
 
 /*
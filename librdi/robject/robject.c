@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2011-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -27,57 +27,283 @@
 
 #include <rdi/robject.h>
 
+/*
+ * change notification for client-side rcall caches
+ *
+ * Each robject keeps the set of processes that have cached something about
+ * it (by pid), and only those are told when it changes.
+ */
+
+static int _is_cacheable(const char *call) {
+	return (!strcmp(call, "type") || !strcmp(call, "size") 
+		|| !strcmp(call, "find") || !strcmp(call, "get-key"));
+}
+
+static bool _is_cacher(struct robject *ro, uint32_t pid) {
+	uint32_t i;
+
+	for (i = 0; i < ro->cacher_count; i++) {
+		if (ro->cacher[i] == pid) return true;
+	}
+
+	return false;
+}
+
+void robject_watch(struct robject *ro, rp_t source) {
+	uint32_t pid = RP_PID(source);
+	uint32_t *cacher;
+	bool known;
+
+	if (!ro || !pid) {
+		return;
+	}
+
+	rwlock_rspin(&ro->lock);
+	known = _is_cacher(ro, pid);
+	rwlock_rfree(&ro->lock);
+
+	if (known) {
+		return;
+	}
+
+	rwlock_wspin(&ro->lock);
+	if (!_is_cacher(ro, pid)) {
+		cacher = realloc(ro->cacher, sizeof(uint32_t) * (ro->cacher_count + 1));
+
+		if (cacher) {
+			cacher[ro->cacher_count++] = pid;
+			ro->cacher = cacher;
+		}
+	}
+	rwlock_wfree(&ro->lock);
+}
+
+static void _unwatch(struct robject *ro, uint32_t pid) {
+	uint32_t i;
+
+	rwlock_wspin(&ro->lock);
+	for (i = 0; i < ro->cacher_count; i++) {
+		if (ro->cacher[i] == pid) {
+			ro->cacher[i] = ro->cacher[--ro->cacher_count];
+			break;
+		}
+	}
+	rwlock_wfree(&ro->lock);
+}
+
+void robject_changed(struct robject *ro, const char *what) {
+	uint32_t *pids;
+	uint32_t count, i;
+	char *value;
+
+	if (!ro || !ro->cacher_count) {
+		return;
+	}
+
+	// take a snapshot of the set, so no lock is held while sending
+	rwlock_rspin(&ro->lock);
+	count = ro->cacher_count;
+	pids = malloc(sizeof(uint32_t) * count);
+	if (pids) memcpy(pids, ro->cacher, sizeof(uint32_t) * count);
+	rwlock_rfree(&ro->lock);
+
+	if (!pids) {
+		return;
+	}
+
+	if (what) {
+		value = saprintf("changed %r %s", RP_CONS(getpid(), ro->index), what);
+	}
+	else {
+		value = saprintf("changed %r", RP_CONS(getpid(), ro->index));
+	}
+
+	if (value) {
+		for (i = 0; i < count; i++) {
+			if (event(RP_CONS(pids[i], 0), value)) {
+				// process is gone; forget it
+				_unwatch(ro, pids[i]);
+			}
+		}
+
+		free(value);
+	}
+
+	free(pids);
+}
+
 /*
  * various field manipulations
  */
 
 void robject_set_call(struct robject *ro, const char *call, rcall_t hook, int class) {
+	struct robject_rcall *entry, *old;
+	uint32_t atom;
 	
 	if (ro) {
-		mutex_spin(&ro->mutex);
-		ro->call_table = s_table_set(ro->call_table, call, (void*) (uintptr_t) hook);
-		ro->call_class = s_table_set(ro->call_class, call, (void*) class);
-		mutex_free(&ro->mutex);
+		atom = s_atom(call);
+		if (!atom) return;
+
+		entry = malloc(sizeof(struct robject_rcall));
+		if (!entry) return;
+
+		entry->hook  = hook;
+		entry->class = class;
+
+		// readers copy entries out under the lock, so the old one can go
+		rwlock_wspin(&ro->lock);
+		old = s_map_get(ro->call_table, atom);
+		ro->call_table = s_map_set(ro->call_table, atom, entry);
+		rwlock_wfree(&ro->lock);
+
+		free(old);
 	}
 }
 
-rcall_t robject_get_call(struct robject *ro, const char *call) {
+/*
+ * Finds the hook for the call <atom> and its action class in a single walk
+ * up the class chain of <ro>. As always, the action class only applies to
+ * calls that <ro> defines itself; calls inherited from a class are not 
+ * checked against keys (clients rely on this, e.g. for set-link).
+ */
+
+static rcall_t _get_call(struct robject *ro, uint32_t atom, uint32_t *class) {
+	struct robject_rcall *entry;
+	struct robject *self;
 	rcall_t hook;
-	
-	if (ro) {
-		mutex_spin(&ro->mutex);
 
-		// read hook
-		hook = (rcall_t) (uintptr_t) s_table_get(ro->call_table, call);
+	// walk up the class chain to the first object defining the call
+	for (self = ro; ro; ro = ro->parent) {
+		rwlock_rspin(&ro->lock);
+		entry = s_map_get(ro->call_table, atom);
+		if (entry && entry->hook) {
+			hook = entry->hook;
+			if (class) *class = (ro == self) ? (uint32_t) entry->class : 0;
+			rwlock_rfree(&ro->lock);
+			return hook;
+		}
+		rwlock_rfree(&ro->lock);
+	}
+
+	return NULL;
+}
+
+rcall_t robject_get_call(struct robject *ro, const char *call) {
+	uint32_t atom;
+
+	// a call name that was never interned is not defined anywhere
+	atom = s_atom_find(call);
 
-		// if not defined, fall back to parent
-		if (!hook) hook = robject_get_call(ro->parent, call);
+	return (atom) ? _get_call(ro, atom, NULL) : NULL;
+}
 
-		mutex_free(&ro->mutex);
+void robject_set_brcall(struct robject *ro, uint32_t method, const char *sig, brcall_t hook, int class) {
+	struct robject_brcall *table;
+	uint32_t count;
 
-		return hook;
+	if (!ro || method >= BRCALL_MAXID) {
+		return;
 	}
-	else {
-		return NULL;
+
+	rwlock_wspin(&ro->lock);
+
+	if (method >= ro->brcall_count) {
+		count = method + 1;
+		table = realloc(ro->brcall_table, sizeof(struct robject_brcall) * count);
+
+		if (!table) {
+			rwlock_wfree(&ro->lock);
+			return;
+		}
+
+		memset(&table[ro->brcall_count], 0, 
+			sizeof(struct robject_brcall) * (count - ro->brcall_count));
+
+		ro->brcall_table = table;
+		ro->brcall_count = count;
+	}
+
+	ro->brcall_table[method].hook  = hook;
+	ro->brcall_table[method].sig   = sig;
+	ro->brcall_table[method].class = class;
+
+	rwlock_wfree(&ro->lock);
+}
+
+/*
+ * Copies the binary call entry for <method> into <entry>, walking up the
+ * class chain of <ro>. The copy is taken under the read lock, because
+ * robject_set_brcall may reallocate the table at any time. As with rcalls
+ * (see _get_call), the action class of a method inherited from a class is 
+ * reported as 0, so the same method has the same access rules over either
+ * transport. Returns zero on success, nonzero if no object in the chain 
+ * defines <method>.
+ */
+
+int robject_get_brcall(struct robject *ro, uint32_t method, struct robject_brcall *entry) {
+	struct robject *self;
+
+	// walk up the class chain to the first object defining the method
+	for (self = ro; ro; ro = ro->parent) {
+		rwlock_rspin(&ro->lock);
+		if (method < ro->brcall_count && ro->brcall_table[method].hook) {
+			*entry = ro->brcall_table[method];
+			if (ro != self) entry->class = 0;
+			rwlock_rfree(&ro->lock);
+			return 0;
+		}
+		rwlock_rfree(&ro->lock);
+	}
+
+	return 1;
+}
+
+void robject_set_type(struct robject *ro, const char *type) {
+
+	if (ro) {
+		rwlock_wspin(&ro->lock);
+		ro->type = type;
+		rwlock_wfree(&ro->lock);
+
+		robject_changed(ro, NULL);
+	}
+}
+
+void robject_set_size(struct robject *ro, off_t size) {
+
+	if (ro) {
+		rwlock_wspin(&ro->lock);
+		ro->size = size;
+		rwlock_wfree(&ro->lock);
+
+		robject_changed(ro, NULL);
 	}
 }
 
 void robject_set_data(struct robject *ro, const char *field, void *data) {
+	uint32_t atom;
 	
 	if (ro) {
-		mutex_spin(&ro->mutex);
-		ro->data_table = s_table_set(ro->data_table, field, data);
-		mutex_free(&ro->mutex);
+		atom = s_atom(field);
+		if (!atom) return;
+
+		rwlock_wspin(&ro->lock);
+		ro->data_table = s_map_set(ro->data_table, atom, data);
+		rwlock_wfree(&ro->lock);
 	}
 }
 
 void *robject_get_data(struct robject *ro, const char *field) {
+	uint32_t atom;
 	void *data;
 
 	if (ro) {
-		mutex_spin(&ro->mutex);
-		data = s_table_get(ro->data_table, field);
-		mutex_free(&ro->mutex);
+		atom = s_atom_find(field);
+		if (!atom) return NULL;
+
+		rwlock_rspin(&ro->lock);
+		data = s_map_get(ro->data_table, atom);
+		rwlock_rfree(&ro->lock);
 
 		return data;
 	}
@@ -90,20 +316,9 @@ void *robject_get_data(struct robject *ro, const char *field) {
  * basic interface
  */
 
-static void _iter(void *arg0, const char *key, void *value) {
-	event(atoi(key), arg0);
-}
-
-void robject_event(struct robject *ro, const char *event) {
-	
-	if (ro) {
-		mutex_spin(&ro->mutex);
-		s_table_iter(ro->subs_table, (void*) event, _iter);
-		mutex_free(&ro->mutex);
-	}
-}
-
 char *robject_call(struct robject *ro, rp_t source, rk_t key, const char *args) {
+	uint32_t atom;
+	uint32_t class;
 	rcall_t call;
 	int argc;
 	char **argv;
@@ -114,78 +329,100 @@ char *robject_call(struct robject *ro, rp_t source, rk_t key, const char *args)
 	if (!argv) return NULL;
 	for (argc = 0; argv[argc]; argc++);
 
-	// get requested hook
-	call = robject_get_call(ro, argv[0]);
+	// get requested hook and its action class
+	atom = s_atom_find(argv[0]);
+	call = (atom) ? _get_call(ro, atom, &class) : NULL;
 
 	if (!call) {
-		// no hook; free argument list and return ENOSYS
-		for (argc = 0; argv[argc]; argc++) free(argv[argc]);
-		free(argv);
+		rets = errorstr(ENOSYS);
+	}
+	else if (source && class != 0 && (class >= 8 || key != ro->key[class])) {
+		// bad key
+		rets = errorstr(EACCES);
+	}
+	else {
+		rets = call(ro, source, argc, argv);
+	}
 
-		return errorstr(ENOSYS);
+	if (call && source && _is_cacheable(argv[0]) && (!iserror(rets) || !strcmp(argv[0], "find"))) {
+		// the caller may cache this (failed finds included); tell it when
+		// the answer changes
+		robject_watch(ro, source);
 	}
 
-	if (source) {
+	for (argc = 0; argv[argc]; argc++) free(argv[argc]);
+	free(argv);
 
-		// get call action class
-		mutex_spin(&ro->mutex);
-		uint32_t class = (uint32_t) s_table_get(ro->call_class, argv[0]);	
-		mutex_free(&ro->mutex);
+	return rets;
+}
 
-		// check key
-		if (class != 0 && (class > 8 || key != ro->key[class])) {
-			return errorstr(EACCES);
-		}
+int robject_brcall(struct robject *ro, rp_t source, rk_t key, uint32_t method, const char *sig, struct brcall_arg *argv) {
+	struct robject_brcall entry;
+	int argc;
+
+	if (robject_get_brcall(ro, method, &entry)) {
+		return -ENOSYS;
+	}
+
+	if (strcmp(entry.sig, sig)) {
+		return -EINVAL;
 	}
 
-	rets = call(ro, source, argc, argv);
+	// check key
+	if (source && entry.class != 0 && 
+			((uint32_t) entry.class >= 8 || key != ro->key[entry.class])) {
+		return -EACCES;
+	}
 
-	for (argc = 0; argv[argc]; argc++) free(argv[argc]);
-	free(argv);
+	argc = strlen(sig);
 
-	return rets;
+	return entry.hook(ro, source, argc, argv);
 }
 
 void *robject_data(struct robject *ro, const char *field) {
 	return robject_get_data(ro, field);
 }
 
-int robject_get_access(struct robject *ro, rp_t source) {
+int robject_get_access(struct robject *ro, uint32_t user) {
 	int access_level = 0;
 
 	if (ro) {
-		mutex_spin(&ro->mutex);
-		access_level = (int) s_table_getv(ro->accs_table, "uid-%u", getuser(source));
+		rwlock_rspin(&ro->lock);
+		access_level = (int) s_map_get(ro->accs_table, user);
 		if ((access_level & 0x100) == 0) {
-			access_level = (int) s_table_get(ro->accs_table, "default");
+			access_level = ro->accs_default;
 		}
 		access_level &= ~0x100;
-		mutex_free(&ro->mutex);
+		rwlock_rfree(&ro->lock);
 	}
 
 	return access_level;
 }
 
 int robject_check_access(struct robject *ro, rp_t source, int access) {
-	return ((access & robject_get_access(ro, source)) == access);
+	return ((access & robject_get_access(ro, getuser(RP_PID(source)))) == access);
 }
 
-void robject_set_access(struct robject *ro, rp_t source, int access) {
+void robject_set_access(struct robject *ro, uint32_t user, int access) {
 	
 	access |= 0x100;
 
 	if (ro) {
-		mutex_spin(&ro->mutex);
-		ro->accs_table = s_table_setv(ro->accs_table, (void*) access, "uid-%u", getuser(source));
-		mutex_free(&ro->mutex);
+		rwlock_wspin(&ro->lock);
+		ro->accs_table = s_map_set(ro->accs_table, user, (void*) access);
+		rwlock_wfree(&ro->lock);
+
+		robject_changed(ro, NULL);
 	}
 }
 
 void robject_set_default_access(struct robject *ro, int access) {
 	
 	if (ro) {
-		mutex_spin(&ro->mutex);
-		ro->accs_table = s_table_set(ro->accs_table, "default", (void*) access);
-		mutex_free(&ro->mutex);
+		rwlock_wspin(&ro->lock);
+		ro->accs_default = access;
+		rwlock_wfree(&ro->lock);
+
+		robject_changed(ro, NULL);
 	}
 }
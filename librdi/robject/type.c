@@ -30,20 +30,14 @@ int robject_is_type(const char *typestr, const char *type) {
 }
 
 int robject_check_type(struct robject *ro, const char *type) {
-	char *typestr;
 
-	typestr = robject_call(ro, 0, 0, "type");
-
-	if (!typestr) {
-		return 0;
+	// walk the class chain's type fields directly rather than building the
+	// whole type string through a "type" rcall
+	for (; ro; ro = ro->parent) {
+		if (ro->type && strstr(ro->type, type)) {
+			return 1;
+		}
 	}
 
-	if (strstr(typestr, type)) {
-		free(typestr);
-		return 1;
-	}
-	else {
-		free(typestr);
-		return 0;
-	}
+	return 0;
 }
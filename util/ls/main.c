@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009-2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2009-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -21,12 +21,32 @@
 
 #include <rho/natio.h>
 
+/*****************************************************************************
+ * ls - list directory contents
+ *
+ * SYNOPSIS
+ *
+ *   ls [-l] [dir]
+ *
+ *   Lists the entries of <dir>, or of the working directory if none is 
+ *   given. With -l, each entry is printed on its own line along with its 
+ *   size and type.
+ */
+
 int main(int argc, char **argv) {
+	struct rp_dirent *entry;
 	char *list, *path;
 	char **listv;
 	uint64_t dir;
+	bool lflag;
 	int i;
 
+	lflag = (argc > 1 && !strcmp(argv[1], "-l"));
+	if (lflag) {
+		argc--;
+		argv++;
+	}
+
 	if (argc == 1) {
 		path = (char*) getenv("PWD");
 	}
@@ -42,8 +62,35 @@ int main(int argc, char **argv) {
 		abort();
 	}
 
+	// names, pointers, types and sizes in one round trip per page
+	entry = rp_listx(dir, NULL);
+
+	if (entry) {
+		for (i = 0; entry[i].name; i++) {
+			if (lflag) {
+				printf("%10llu %s\t%s\n", (unsigned long long) entry[i].size, 
+					entry[i].name, entry[i].type);
+			}
+			else {
+				printf("%s\t", entry[i].name);
+				if (i % 8 == 7 && entry[i+1].name) printf("\n");
+			}
+		}
+		if (!lflag) printf("\n");
+
+		free(entry);
+		return EXIT_SUCCESS;
+	}
+
+	if (errno != ENOSYS) {
+		fprintf(stderr, "%s: ", path);
+		perror(NULL);
+		abort();
+	}
+
+	// driver does not support listx; list names only
 	errno = 0;
-	list = fs_list(path);
+	list = rp_list(dir);
 	if (!list) {
 		if (errno) {
 			fprintf(stderr, "%s: ", path);
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2012 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * 
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "test.h"
+
+int test_format(void) {
+	return 0
+		+ test_format_int()
+		+ test_format_precision()
+	;
+}
+
+int test_format_int(void) {
+	char buffer[32];
+
+	printf("\tformat_int");
+
+	snprintf(buffer, sizeof(buffer), "%.5d", -42);
+	if (strcmp(buffer, "-00042")) return 1;
+	printf(".");
+
+	snprintf(buffer, sizeof(buffer), "%8.3d|%-8.3d|", 42, 42);
+	if (strcmp(buffer, "     042|042     |")) return 1;
+	printf(".");
+
+	snprintf(buffer, sizeof(buffer), "%08.3d", 42);
+	if (strcmp(buffer, "     042")) return 1;
+	printf(".");
+
+	snprintf(buffer, sizeof(buffer), "%#.6x %05d", 42, -42);
+	if (strcmp(buffer, "0x00002a -0042")) return 1;
+	printf(".");
+
+	printf(" passed.\n");
+
+	return 0;
+}
+
+/*
+ * Integer precisions far larger than the conversion buffer on the stack 
+ * must come out as padding, not as digits written past its start.
+ */
+
+int test_format_precision(void) {
+	char *buffer;
+	size_t i;
+	int length;
+
+	printf("\tformat_precision");
+
+	buffer = malloc(1024);
+	if (!buffer) return 1;
+
+	length = snprintf(buffer, 1024, "%.500x", 0x2a);
+	if (length != 500 || strlen(buffer) != 500) return 1;
+	if (strcmp(&buffer[498], "2a")) return 1;
+	for (i = 0; i < 498; i++) {
+		if (buffer[i] != '0') return 1;
+	}
+	printf(".");
+
+	length = snprintf(buffer, 1024, "%-+*.*d|", 300, 200, 7);
+	if (length != 301 || buffer[0] != '+' || buffer[200] != '7') return 1;
+	if (buffer[1] != '0' || buffer[201] != ' ' || buffer[300] != '|') return 1;
+	printf(".");
+
+	length = snprintf(buffer, 16, "%.200u", 1);
+	if (length != 200 || strcmp(buffer, "000000000000000")) return 1;
+	printf(".");
+
+	free(buffer);
+
+	printf(" passed.\n");
+
+	return 0;
+}
@@ -18,6 +18,8 @@
 #include <string.h>
 #include <stdio.h>
 
+#include <rho/proc.h>
+
 #include "test.h"
 
 int test_heap(void) {
@@ -28,6 +30,7 @@ int test_heap(void) {
 //		+ test_aalloc()
 		+ test_realloc()
 		+ test_heap_torture()
+		+ test_realloc_bench()
 	;
 }
 
@@ -143,6 +146,34 @@ int test_realloc(void) {
 	if (strcmp(block, value)) return 1;
 	else printf(".");
 
+	block = realloc(block, 10);
+	if (block == NULL || strncmp(block, value, 10)) return 1;
+	else printf(".");
+
+	/* grow into page runs */
+	block = realloc(block, PAGESZ * 3);
+	if (block == NULL || strncmp(block, value, 10)) return 1;
+	else printf(".");
+
+	memset(block, 'x', PAGESZ * 3);
+	block = realloc(block, PAGESZ * 20);
+	if (block == NULL || block[0] != 'x' || block[PAGESZ * 3 - 1] != 'x') return 1;
+	else printf(".");
+
+	memset(block, 'y', PAGESZ * 20);
+	block = realloc(block, PAGESZ * 40);
+	if (block == NULL || block[0] != 'y' || block[PAGESZ * 20 - 1] != 'y') return 1;
+	else printf(".");
+
+	/* shrink in place */
+	value = block;
+	block = realloc(block, PAGESZ * 5);
+	if (block != value || block[PAGESZ * 5 - 1] != 'y') return 1;
+	else printf(".");
+
+	free(block);
+	printf(".");
+
 	printf(" passed.\n");
 
 	return 0;
@@ -171,3 +202,52 @@ int test_heap_torture(void) {
 
 	return 0;
 }
+
+int test_realloc_bench(void) {
+	const size_t total = 0x100000;
+	char chunk[512];
+	char *block, *new;
+	uint64_t t;
+	size_t i;
+
+	printf("\trealloc_bench");
+
+	memset(chunk, 'z', sizeof(chunk));
+
+	/* append with realloc */
+	t = getktime();
+	block = NULL;
+	for (i = 0; i < total; i += sizeof(chunk)) {
+		block = realloc(block, i + sizeof(chunk));
+		if (!block) return 1;
+		memcpy(&block[i], chunk, sizeof(chunk));
+	}
+	t = getktime() - t;
+
+	if (block[0] != 'z' || block[total - 1] != 'z') return 1;
+	free(block);
+
+	printf(" realloc: %d ms", (int) ((uint32_t) t * 1000 / 256));
+
+	/* append with malloc, copy and free */
+	t = getktime();
+	block = NULL;
+	for (i = 0; i < total; i += sizeof(chunk)) {
+		new = malloc(i + sizeof(chunk));
+		if (!new) return 1;
+		if (block) memcpy(new, block, i);
+		free(block);
+		block = new;
+		memcpy(&block[i], chunk, sizeof(chunk));
+	}
+	t = getktime() - t;
+
+	if (block[0] != 'z' || block[total - 1] != 'z') return 1;
+	free(block);
+
+	printf(" copy: %d ms", (int) ((uint32_t) t * 1000 / 256));
+
+	printf(" passed.\n");
+
+	return 0;
+}
@@ -88,5 +88,19 @@ int main(int argc, char **argv) {
 		}
 	}
 
+	if (!strcmp(testsuite, "format") || !strcmp(testsuite, "all")) {
+		if (test_format()) {
+			printf("format tests failed.\n");
+			return 1;
+		}
+	}
+
+	if (!strcmp(testsuite, "robject") || !strcmp(testsuite, "all")) {
+		if (test_robject()) {
+			printf("robject tests failed.\n");
+			return 1;
+		}
+	}
+
 	return 0;
 }
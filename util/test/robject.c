@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2012 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * 
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <rho/mutex.h>
+#include <rho/proc.h>
+
+#include <rdi/robject.h>
+
+#include "test.h"
+
+int test_robject(void) {
+	return 0
+		+ test_robject_index()
+		+ test_robject_bench()
+	;
+}
+
+int test_robject_index(void) {
+	static const uint32_t sparse[] = { 0x1000, 0xFFFFF, 0x1000000, 0xFFFFFFFF };
+	struct robject *ro[64];
+	uint32_t index[64];
+	size_t i;
+
+	printf("\trobject_index");
+
+	for (i = 0; i < 64; i++) {
+		index[i] = robject_new_index();
+		ro[i] = robject_cons(index[i], NULL);
+		if (!ro[i]) return 1;
+	}
+
+	for (i = 0; i < 64; i++) {
+		if (robject_get(index[i]) != ro[i]) return 1;
+	}
+
+	for (i = 0; i < 64; i += 2) {
+		robject_set(index[i], NULL);
+		if (robject_get(index[i])) return 1;
+		if (robject_get(index[i + 1]) != ro[i + 1]) return 1;
+		robject_set(index[i], ro[i]);
+	}
+
+	/* indexes far from the dense range */
+	for (i = 0; i < sizeof(sparse) / sizeof(sparse[0]); i++) {
+		if (robject_get(sparse[i])) return 1;
+		robject_set(sparse[i], ro[0]);
+		if (robject_get(sparse[i]) != ro[0]) return 1;
+		robject_set(sparse[i], NULL);
+		if (robject_get(sparse[i])) return 1;
+	}
+
+	for (i = 0; i < 64; i++) {
+		robject_free(ro[i]);
+		if (robject_get(index[i])) return 1;
+	}
+
+	printf("\tpassed.\n");
+
+	return 0;
+}
+
+/*
+ * Lookup throughput from many concurrent threads, as seen by message 
+ * handlers calling robject_get() on every request.
+ */
+
+#define BENCH_OBJECTS 1024
+#define BENCH_LOOKUPS 0x100000
+
+static uint32_t _bench_base;
+static volatile int _bench_running;
+static volatile int _bench_errors;
+static bool _bench_mutex;
+
+static void _bench_thread(void) {
+	uint32_t i, index;
+
+	for (i = 0; i < BENCH_LOOKUPS; i++) {
+		index = _bench_base + ((i * 7) & (BENCH_OBJECTS - 1));
+		if (!robject_get(index)) _bench_errors++;
+	}
+
+	mutex_spin(&_bench_mutex);
+	_bench_running--;
+	mutex_free(&_bench_mutex);
+
+	done();
+}
+
+int test_robject_bench(void) {
+	static struct robject *ro[BENCH_OBJECTS];
+	uint64_t t;
+	double lookups;
+	int threads, i;
+
+	printf("\trobject_bench\n");
+
+	_bench_base = robject_new_index();
+	ro[0] = robject_cons(_bench_base, NULL);
+	for (i = 1; i < BENCH_OBJECTS; i++) {
+		ro[i] = robject_cons(robject_new_index(), NULL);
+	}
+
+	for (threads = 1; threads <= 16; threads *= 2) {
+		_bench_running = threads;
+		_bench_errors = 0;
+
+		t = getktime();
+		for (i = 0; i < threads; i++) also(_bench_thread);
+		while (_bench_running) sleep();
+		t = getktime() - t;
+
+		if (_bench_errors) return 1;
+
+		/* getktime ticks at 256 Hz */
+		if (!t) t = 1;
+		lookups = (double) threads * BENCH_LOOKUPS * 256 / (double) (uint32_t) t;
+		printf("\t\t%d threads: %d lookups/ms\n", threads, (int) (lookups / 1000));
+	}
+
+	for (i = 0; i < BENCH_OBJECTS; i++) {
+		robject_free(ro[i]);
+	}
+
+	return 0;
+}
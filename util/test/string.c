@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009, 2010 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * Copyright (C) 2009-2012 Nick Johnson <nickbjohnson4224 at gmail.com>
  * 
  * Permission to use, copy, modify, and distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -18,6 +18,8 @@
 #include <string.h>
 #include <stdio.h>
 
+#include <rho/proc.h>
+
 #include "test.h"
 
 int test_string(void) {
@@ -44,6 +46,8 @@ int test_string(void) {
 		+ test_strtok()
 		+ test_strdup()
 		+ test_strparse()
+		+ test_string_sweep()
+		+ test_string_bench()
 	;
 }
 
@@ -391,3 +395,136 @@ int test_strparse(void) {
 
 	return 0;
 }
+
+static void _sweep_fill(uint8_t *buffer, size_t size, uint32_t seed) {
+	size_t i;
+
+	for (i = 0; i < size; i++) {
+		seed = seed * 1103515245 + 12345;
+		buffer[i] = seed >> 16;
+	}
+}
+
+int test_string_sweep(void) {
+	static uint8_t buffer[1024], check[1024];
+	size_t n, a, b, i;
+	uint8_t *p;
+
+	printf("\tstring_sweep");
+
+	for (n = 0; n < 300; n++) {
+		for (a = 0; a < 16; a++) {
+			b = (a * 7 + n) % 16;
+
+			/* memcpy */
+			_sweep_fill(buffer, 1024, n * 16 + a);
+			memcpy(check, buffer, 1024);
+			memcpy(&buffer[a], &buffer[512 + b], n);
+			for (i = 0; i < n; i++) check[a + i] = check[512 + b + i];
+			if (memcmp(buffer, check, 1024)) return 1;
+
+			/* memmove, both directions */
+			memmove(&buffer[a + b], &buffer[a], n);
+			for (i = n; i > 0; i--) check[a + b + i - 1] = check[a + i - 1];
+			if (memcmp(buffer, check, 1024)) return 1;
+
+			memmove(&buffer[a], &buffer[a + b], n);
+			for (i = 0; i < n; i++) check[a + i] = check[a + b + i];
+			if (memcmp(buffer, check, 1024)) return 1;
+
+			/* memset and memclr */
+			memset(&buffer[a], n, n);
+			for (i = 0; i < n; i++) check[a + i] = n;
+			if (memcmp(buffer, check, 1024)) return 1;
+
+			memclr(&buffer[b], n);
+			for (i = 0; i < n; i++) check[b + i] = 0;
+			if (memcmp(buffer, check, 1024)) return 1;
+
+			/* memchr */
+			_sweep_fill(buffer, 1024, n * 16 + a);
+			p = NULL;
+			for (i = 0; i < n; i++) {
+				if (buffer[a + i] == (uint8_t) n) {
+					p = &buffer[a + i];
+					break;
+				}
+			}
+			if (memchr(&buffer[a], n, n) != p) return 1;
+
+			/* strlen */
+			for (i = 0; i < n; i++) {
+				if (!buffer[a + i]) buffer[a + i] = 1;
+			}
+			buffer[a + n] = '\0';
+			if (strlen((char*) &buffer[a]) != n) return 1;
+		}
+
+		if (n % 30 == 0) printf(".");
+	}
+
+	printf(" passed.\n");
+
+	return 0;
+}
+
+static uint32_t _bench_rate(size_t bytes, uint64_t ticks) {
+
+	if (!ticks) ticks = 1;
+
+	/* MB/s, with getktime() ticking at 256 Hz */
+	return (double) bytes * 256 / (double) (uint32_t) ticks / 1048576;
+}
+
+int test_string_bench(void) {
+	static const size_t sizes[] = { 16, 64, 256, 4096, 65536 };
+	const size_t total = 0x1000000;
+	uint8_t *src, *dst;
+	size_t i, j, k, size;
+	uint64_t t;
+
+	printf("\tstring_bench\n");
+
+	src = aalloc(65536 + 16, 16);
+	dst = aalloc(65536 + 16, 16);
+	if (!src || !dst) return 1;
+
+	memset(src, 'z', 65536 + 16);
+	src[65536 + 15] = '\0';
+
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		size = sizes[i];
+
+		/* aligned and misaligned by one byte */
+		for (j = 0; j < 2; j++) {
+			printf("\t\t%d bytes%s:", size, (j) ? " (unaligned)" : "");
+
+			t = getktime();
+			for (k = 0; k < total; k += size) memcpy(&dst[j], &src[0], size);
+			printf(" memcpy %d MB/s", _bench_rate(total, getktime() - t));
+
+			t = getktime();
+			for (k = 0; k < total; k += size) memmove(&dst[j], &dst[16], size);
+			printf(" memmove %d MB/s", _bench_rate(total, getktime() - t));
+
+			t = getktime();
+			for (k = 0; k < total; k += size) memset(&dst[j], 0, size);
+			printf(" memset %d MB/s", _bench_rate(total, getktime() - t));
+
+			t = getktime();
+			for (k = 0; k < total; k += size) if (memchr(&src[j], 'a', size)) return 1;
+			printf(" memchr %d MB/s", _bench_rate(total, getktime() - t));
+
+			t = getktime();
+			for (k = 0; k < total; k += size) if (strlen((char*) &src[65536 + 15 - size]) != size) return 1;
+			printf(" strlen %d MB/s\n", _bench_rate(total, getktime() - t));
+		}
+	}
+
+	free(src);
+	free(dst);
+
+	printf("\t\tpassed.\n");
+
+	return 0;
+}
@@ -47,6 +47,8 @@ int test_strcspn(void);
 int test_strtok(void);
 int test_strdup(void);
 int test_strparse(void);
+int test_string_sweep(void);
+int test_string_bench(void);
 
 /* stdlib tests ************************************************************/
 
@@ -62,6 +64,7 @@ int test_aalloc(void);
 int test_msize(void);
 int test_realloc(void);
 int test_heap_torture(void);
+int test_realloc_bench(void);
 
 int test_convert(void);
 
@@ -90,4 +93,18 @@ int test_ldiv(void);
 int test_bsearch(void);
 int test_qsort(void);
 
+/* stdio tests *************************************************************/
+
+int test_format(void);
+
+int test_format_int(void);
+int test_format_precision(void);
+
+/* librdi tests ************************************************************/
+
+int test_robject(void);
+
+int test_robject_index(void);
+int test_robject_bench(void);
+
 #endif/*TEST_H*/
@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2012 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * 
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include <rho/proc.h>
+#include <rho/abi.h>
+#include <rho/ipc.h>
+
+/*****************************************************************************
+ * trace - kernel IPC trace dump
+ *
+ * Drains the kernel IPC trace buffer for a number of seconds (default one),
+ * then prints the message rate for each pair of communicating processes and
+ * a histogram of request/reply round trip latencies. A round trip is counted
+ * from a non-reply message sent from A to B to the next reply sent from B 
+ * back to A.
+ */
+
+#define MAX_PAIRS	256
+#define MAX_PENDING	1024
+#define MAX_RECORDS	65536
+
+struct pair {
+	uint16_t source;
+	uint16_t target;
+	uint32_t count;
+	uint32_t pages;
+};
+
+struct pending {
+	uint16_t source;
+	uint16_t target;
+	uint64_t tsc;
+};
+
+static struct _trace *record;
+static size_t         record_count;
+
+static struct pair    pair[MAX_PAIRS];
+static size_t         pair_count;
+
+static struct pending pending[MAX_PENDING];
+static size_t         pending_count;
+
+static uint32_t       histogram[64];
+static uint32_t       exits;
+
+static uint64_t rdtsc(void) {
+	uint64_t tsc;
+
+	__asm__ volatile ("rdtsc" : "=A" (tsc));
+
+	return tsc;
+}
+
+static void drain(void) {
+	int n;
+
+	while (record_count < MAX_RECORDS) {
+		n = _trce(&record[record_count], MAX_RECORDS - record_count);
+
+		if (n <= 0) {
+			break;
+		}
+
+		record_count += n;
+	}
+}
+
+static struct pair *get_pair(uint16_t source, uint16_t target) {
+	size_t i;
+
+	for (i = 0; i < pair_count; i++) {
+		if (pair[i].source == source && pair[i].target == target) {
+			return &pair[i];
+		}
+	}
+
+	if (pair_count == MAX_PAIRS) {
+		return NULL;
+	}
+
+	pair[pair_count].source = source;
+	pair[pair_count].target = target;
+	pair[pair_count].count  = 0;
+	pair[pair_count].pages  = 0;
+
+	return &pair[pair_count++];
+}
+
+static void match_reply(struct _trace *t) {
+	uint64_t cycles;
+	size_t i;
+	int bucket;
+
+	/* find oldest outstanding request in the other direction */
+	for (i = 0; i < pending_count; i++) {
+		if (pending[i].source == t->target_pid && pending[i].target == t->source_pid) {
+			break;
+		}
+	}
+
+	if (i == pending_count) {
+		return;
+	}
+
+	cycles = t->tsc - pending[i].tsc;
+
+	for (bucket = 0; bucket < 63 && (cycles >> (bucket + 1)); bucket++);
+	histogram[bucket]++;
+
+	for (pending_count--; i < pending_count; i++) {
+		pending[i] = pending[i + 1];
+	}
+}
+
+static void analyze(void) {
+	struct _trace *t;
+	struct pair *p;
+	size_t i;
+
+	for (i = 0; i < record_count; i++) {
+		t = &record[i];
+
+		if (t->type == TRACE_EXIT) {
+			exits++;
+			continue;
+		}
+
+		p = get_pair(t->source_pid, t->target_pid);
+		if (p) {
+			p->count++;
+			p->pages += t->count;
+		}
+
+		if (!t->source_pid) {
+			continue;
+		}
+
+		if (t->port == ACTION_REPLY) {
+			match_reply(t);
+		}
+		else if (pending_count < MAX_PENDING) {
+			pending[pending_count].source = t->source_pid;
+			pending[pending_count].target = t->target_pid;
+			pending[pending_count].tsc    = t->tsc;
+			pending_count++;
+		}
+	}
+}
+
+int main(int argc, char **argv) {
+	uint64_t ktime0, ktime1, tsc0, tsc1;
+	uint32_t seconds = 1;
+	double ticks, mhz;
+	size_t i;
+
+	if (argc > 1) {
+		seconds = atoi(argv[1]);
+	}
+
+	record = malloc(sizeof(struct _trace) * MAX_RECORDS);
+	if (!record) {
+		fprintf(stderr, "%s: out of memory\n", argv[0]);
+		return 1;
+	}
+
+	/* discard old records */
+	if (_trce(record, MAX_RECORDS) < 0) {
+		fprintf(stderr, "%s: permission denied\n", argv[0]);
+		return 1;
+	}
+
+	ktime0 = getktime();
+	tsc0   = rdtsc();
+
+	/* collect records until time is up or the buffer is full */
+	do {
+		sleep();
+		drain();
+	} while (getktime() - ktime0 < (uint64_t) seconds * 256 && record_count < MAX_RECORDS);
+
+	ktime1 = getktime();
+	tsc1   = rdtsc();
+
+	ticks = (double) (int64_t) (ktime1 - ktime0);
+	if (ticks < 1) ticks = 1;
+	mhz = (double) (int64_t) (tsc1 - tsc0) * 256 / ticks / 1000000;
+	if (mhz < 1) mhz = 1;
+
+	analyze();
+
+	printf("%d records (%d handler exits) over %d ms, TSC %d MHz\n\n", 
+		record_count, exits, (int) (ticks * 1000 / 256), (int) mhz);
+
+	printf("SOURCE\tTARGET\tMSGS\tPAGES\tMSGS/S\n");
+	for (i = 0; i < pair_count; i++) {
+		printf("%d\t%d\t%d\t%d\t%d\n", pair[i].source, pair[i].target, 
+			pair[i].count, pair[i].pages, (int) (pair[i].count * 256 / ticks));
+	}
+
+	printf("\nROUND TRIP (cycles)\tUSEC\tCOUNT\n");
+	for (i = 0; i < 64; i++) {
+		if (!histogram[i]) continue;
+		printf("2^%d\t\t\t%d\t%d\n", i, (int) ((double) (1ULL << i) / mhz), histogram[i]);
+	}
+
+	free(record);
+
+	return 0;
+}